@@ -8,7 +8,32 @@
  * 
  * Classes: 
  *    Vector - vector data storage class and all related functions
- *    Utils - Utility class including TrimAndUppercase() and OpenFile()
+ *    Utils - Utility class including TrimAndUppercase(), OpenFile(), MapFile(), RunParallel(),
+ *            ResidentSetBytes(), Checksum(), GetFileStamp(), NextLine() and ReadAllStdin()
+ *    Metrics - low-overhead latency histograms, counters and gauges, exported as JSON or Prometheus text
+ *    StringArena - monotonic, shareable block storage for the text of course records
+ *    MappedFile - read-only memory-mapped view of an input file
+ *    CourseKey - packs short course numbers into order-preserving 64-bit integer keys
+ *    KeySearchIndex - Eytzinger or cache-line B-tree ordered copy of sorted keys with branch-free, prefetched search
+ *    CourseHashIndex - open-addressing hash index from course number to collection position
+ *    CourseTrie - array-based trie over sorted course numbers for autocomplete
+ *    NameIndex - inverted index of course name words with varint-compressed posting lists
+ *    PrerequisiteGraph - prerequisites resolved to collection positions, stored in CSR form
+ *    PrerequisiteAnalysis - topological order, levels, cycles and transitive prerequisites of the prerequisite graph
+ *    SharedCatalog - atomically swapped catalog versions, freed through hazard pointers, for lock-free concurrent readers
+ *    ShardedCatalog - one Vector per department file, with a router that resolves prerequisites across departments
+ *    CatalogValidator - parallel whole-file check that reports every malformed line, duplicate, missing
+ *                       prerequisite, self-reference and cycle, with line numbers
+ *    CompactCatalog - struct-of-arrays catalog storage over packed course keys
+ *    OutputBuffer - large reusable output buffer written to a stream in bulk
+ *    BatchQuery - non-interactive lookup of a whole file of course numbers
+ *    EligibilityEngine - bulk next-course eligibility for files of student transcripts, using prerequisite bitsets
+ *    TermPlanner - semester-by-semester plans for target courses, by critical-path list scheduling
+ *    AllocationCounter - counts heap allocations through the replaced global operator new (built with COUNT_ALLOCATIONS)
+ *    CatalogGenerator - deterministic synthetic catalog CSV generator
+ *    Benchmark - repeated, warmed-up timings of the load, sort, search and print paths
+ *    QueryServer - serves course queries to local clients over a Unix domain socket (Linux)
+ *    LoadGenerator - many-connection client that measures QueryServer throughput and latency
  *
  * NOTE: Since the project specified having all code in one file, 
  * the class functions are defined inline as a stylistic choice
@@ -26,6 +51,53 @@
 #include <cctype>
 #include <algorithm>
 #include <ctime>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <cstdint>
+#include <cstdio>
+#include <chrono>
+#include <filesystem>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <cmath>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <unordered_map>
+#include <unordered_set>
+#include <cerrno>
+#include <csignal>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#include <intrin.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(__AVX2__) || defined(__SSE4_2__)
+#include <immintrin.h>
+#endif
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
+#endif
 
 using namespace std;
 
@@ -37,416 +109,7354 @@ using namespace std;
 // Default file path to courses list
 const string FILE_PATH = "CS 300 ABCU_Advising_Program_Input.csv";
 
+// Read-only list of prerequisite course numbers, stored alongside the course text
+struct PrerequisiteList {
+    const string_view* first = nullptr; // first prerequisite
+    const string_view* last = nullptr;  // one past the last prerequisite
+
+    const string_view* begin() const { return first; }
+    const string_view* end() const { return last; }
+    size_t size() const { return static_cast<size_t>(last - first); }
+    bool empty() const { return first == last; }
+    const string_view& operator[](size_t i) const { return first[i]; }
+    bool operator==(const PrerequisiteList& other) const { return equal(first, last, other.first, other.last); }
+};
+
 // Course Structure
+// The text lives in the StringArena of the catalog that holds the course (see Vector),
+// so a Course is a small, trivially copied record that is only valid while that arena is.
 struct Course {
-    string courseNumber;          // alphanumeric identifier for the course
-    string name;                  // name of the course
-    vector<string> prerequisites; // list of courseNumbers (can be empty)
+    string_view courseNumber;       // alphanumeric identifier for the course
+    string_view name;               // name of the course
+    PrerequisiteList prerequisites; // list of courseNumbers (can be empty)
+};
+
+// Outcome of Vector::ReloadCoursesFromMappedFile
+struct ReloadSummary {
+    bool applied = false;   // false if the new file could not be parsed and nothing changed
+    size_t inserted = 0;    // courses only in the new file
+    size_t updated = 0;     // courses in both files whose name or prerequisites changed
+    size_t deleted = 0;     // courses only in the old catalog
+    size_t unchanged = 0;   // courses identical in both
+    double seconds = 0.0;   // wall time of the whole reload
+};
+
+// Outcome of EligibilityEngine::Run
+struct EligibilitySummary {
+    size_t students = 0; // transcripts evaluated
+    size_t eligible = 0; // eligible courses listed over all students
+    size_t unknown = 0;  // completed course numbers not found in the catalog
+};
+
+// Outcome of TermPlanner::Run
+struct PlanningSummary {
+    size_t students = 0; // plans requested
+    size_t failed = 0;   // students with an unknown course, a cycle or a missing prerequisite in their plan
+    size_t terms = 0;    // terms over all successful plans
+};
+
+// A line of the input that could not be turned into a course
+struct ParseError {
+    size_t line; // line number, starting at 1
+    string text; // the line as it appears in the file
+};
+
+// Sorting algorithm used by Vector::SortVector
+enum class SortMode {
+    Quicksort, // recursive Quicksort that swaps whole Course records
+    Radix      // radix sort (introsort fallback) of a key permutation, applied once
+};
+
+// Memory order of the keys searched by KeySearchIndex
+enum class SearchLayout {
+    Binary,    // the sorted key array itself, searched with lower_bound
+    Eytzinger, // breadth-first order, branch-free descent that prefetches four levels ahead
+    BTree      // implicit B-tree with one cache line of keys per node, compared with SIMD when available
 };
 
 
 /* *****************************
- * Utils Class
+ * AllocationCounter Class
  ***************************** */
 
-// Trim and uppercase utility function
-class Utils {
+// Process-wide count of heap allocations, fed by the global operator new below when the
+// program is built with COUNT_ALLOCATIONS defined; otherwise nothing is counted
+class AllocationCounter {
+private:
+    inline static atomic<uint64_t> allocations{ 0 }; // number of calls to operator new
+    inline static atomic<uint64_t> bytes{ 0 };       // bytes requested from operator new
+
 public:
+#ifdef COUNT_ALLOCATIONS
+    static constexpr bool IS_ENABLED = true; // the global operator new feeds the counter
+#else
+    static constexpr bool IS_ENABLED = false; // allocations go straight to the standard library
+#endif
 
     /*
-    * TrimAndUppercase
-    *  Trims leading and trailing spaces from the supplied string and coverts string to uppercase
-    *
-    * @param string stringField - string to trim and convert
-    *
-    * @return string - returns trimmed uppercase string
-    */
-    static string TrimAndUppercase(string stringField) {
-        // Nothing to do if string is empty
-        if (stringField.empty()) {
-            return stringField;
-        }
-
-        // Start and end of the string
-        size_t start = 0;
-        size_t end = stringField.length() - 1;
-
-        // Loop and move the start forward past starting spaces
-        while (start <= end && stringField[start] == ' ') {
-            start++;
-        }
+     * Record
+     *  Counts one allocation; relaxed atomics keep the cost to a few cycles
+     *
+     * @param size_t size - bytes requested
+     */
+    static void Record(size_t size) {
+        allocations.fetch_add(1, memory_order_relaxed);
+        bytes.fetch_add(size, memory_order_relaxed);
+    }
 
-        // Loop and move the end backward past trailing spaces
-        while (end >= start && stringField[end] == ' ') {
-            end--;
-        }
+    /*
+     * Allocations
+     *  Total allocations since the program started
+     *
+     * @return uint64_t - allocation count
+     */
+    static uint64_t Allocations() {
+        return allocations.load(memory_order_relaxed);
+    }
 
-        // use a substring function to extract the trimmed string
-        string result = stringField.substr(start, end - start + 1);
-        // convert result to uppercase
-        transform(result.begin(), result.end(), result.begin(), ::toupper);
-        return result;
+    /*
+     * Bytes
+     *  Total bytes requested since the program started
+     *
+     * @return uint64_t - byte count
+     */
+    static uint64_t Bytes() {
+        return bytes.load(memory_order_relaxed);
     }
 
+#ifdef COUNT_ALLOCATIONS
     /*
-     * OpenFile
-     *  Opens a file for reading
+     * Allocate
+     *  Counts and performs one allocation for the replaced operator new
      *
-     * @param string filePath = "" - USes path and name supplied, or global default
+     * Kept out of line together with Release, so the compiler never sees malloc and free
+     * paired with a new-expression and every form of new reaches the same two functions.
      *
-     * @return ifstream - returns opened file stream
+     * @param size_t size - bytes requested
+     * @param size_t alignment = 0 - required alignment, or 0 for the default
      *
-     * @exception runtime_error is thrown if file cannot be opened
+     * @return void* - the memory, or nullptr if none is available
      */
-    static ifstream OpenFile(string filePath = "") {
-        if (filePath.empty()) {
-            filePath = FILE_PATH;
-        }
+#if defined(__GNUC__) || defined(__clang__)
+    __attribute__((noinline))
+#elif defined(_MSC_VER)
+    __declspec(noinline)
+#endif
+    static void* Allocate(size_t size, size_t alignment = 0) noexcept {
+        Record(size);
+        if (size == 0)
+            size = 1;
+        if (alignment <= alignof(max_align_t))
+            return malloc(size);
+#ifdef _WIN32
+        return _aligned_malloc(size, alignment);
+#else
+        void* memory = nullptr;
+        return posix_memalign(&memory, alignment, size) == 0 ? memory : nullptr;
+#endif
+    }
 
-        ifstream file(filePath);
-        if (!file.is_open()) {
-            throw runtime_error("ERROR: Could not open file"); // throw an error if file cannot be opened
+    /*
+     * Release
+     *  Frees memory returned by Allocate
+     *
+     * @param void* memory - memory to free (nullptr is ignored)
+     * @param size_t alignment = 0 - the alignment it was allocated with
+     */
+#if defined(__GNUC__) || defined(__clang__)
+    __attribute__((noinline))
+#elif defined(_MSC_VER)
+    __declspec(noinline)
+#endif
+    static void Release(void* memory, size_t alignment = 0) noexcept {
+#ifdef _WIN32
+        if (alignment > alignof(max_align_t)) {
+            _aligned_free(memory);
+            return;
         }
-        return file;
+#else
+        (void)alignment;
+#endif
+        free(memory);
+    }
+
+    /*
+     * AllocateOrThrow
+     *  Allocate for the throwing forms of operator new
+     *
+     * @param size_t size - bytes requested
+     * @param size_t alignment = 0 - required alignment, or 0 for the default
+     *
+     * @return void* - the memory
+     *
+     * @exception bad_alloc is thrown if no memory is available
+     */
+    static void* AllocateOrThrow(size_t size, size_t alignment = 0) {
+        void* memory = Allocate(size, alignment);
+        if (memory == nullptr)
+            throw bad_alloc();
+        return memory;
     }
+#endif
 };
 
+#ifdef COUNT_ALLOCATIONS
+// Replacement global allocation functions, so every heap allocation is counted. Every form is
+// replaced, so each delete releases memory that came from the matching new.
+void* operator new(size_t size) { return AllocationCounter::AllocateOrThrow(size); }
+void* operator new[](size_t size) { return AllocationCounter::AllocateOrThrow(size); }
+void* operator new(size_t size, const nothrow_t&) noexcept { return AllocationCounter::Allocate(size); }
+void* operator new[](size_t size, const nothrow_t&) noexcept { return AllocationCounter::Allocate(size); }
+void* operator new(size_t size, align_val_t alignment) { return AllocationCounter::AllocateOrThrow(size, static_cast<size_t>(alignment)); }
+void* operator new[](size_t size, align_val_t alignment) { return AllocationCounter::AllocateOrThrow(size, static_cast<size_t>(alignment)); }
+void* operator new(size_t size, align_val_t alignment, const nothrow_t&) noexcept { return AllocationCounter::Allocate(size, static_cast<size_t>(alignment)); }
+void* operator new[](size_t size, align_val_t alignment, const nothrow_t&) noexcept { return AllocationCounter::Allocate(size, static_cast<size_t>(alignment)); }
+
+void operator delete(void* memory) noexcept { AllocationCounter::Release(memory); }
+void operator delete[](void* memory) noexcept { AllocationCounter::Release(memory); }
+void operator delete(void* memory, size_t) noexcept { AllocationCounter::Release(memory); }
+void operator delete[](void* memory, size_t) noexcept { AllocationCounter::Release(memory); }
+void operator delete(void* memory, const nothrow_t&) noexcept { AllocationCounter::Release(memory); }
+void operator delete[](void* memory, const nothrow_t&) noexcept { AllocationCounter::Release(memory); }
+void operator delete(void* memory, align_val_t alignment) noexcept { AllocationCounter::Release(memory, static_cast<size_t>(alignment)); }
+void operator delete[](void* memory, align_val_t alignment) noexcept { AllocationCounter::Release(memory, static_cast<size_t>(alignment)); }
+void operator delete(void* memory, size_t, align_val_t alignment) noexcept { AllocationCounter::Release(memory, static_cast<size_t>(alignment)); }
+void operator delete[](void* memory, size_t, align_val_t alignment) noexcept { AllocationCounter::Release(memory, static_cast<size_t>(alignment)); }
+void operator delete(void* memory, align_val_t alignment, const nothrow_t&) noexcept { AllocationCounter::Release(memory, static_cast<size_t>(alignment)); }
+void operator delete[](void* memory, align_val_t alignment, const nothrow_t&) noexcept { AllocationCounter::Release(memory, static_cast<size_t>(alignment)); }
+#endif
+
 
 /* *****************************
- * Vector Class
+ * MappedFile Class
  ***************************** */
 
-// Vector class for storing courses
-class Vector {
-/* *****************************
-* Vector Class - Private section
-***************************** */
+// Read-only memory-mapped view of a whole file
+class MappedFile {
 private:
-    // Private varables
-    vector<Course> courseCollection; // Class variable: collection of courses
-    bool isSorted;                   // flag to show if the courseCollection is sorted
+    const char* data; // start of the mapped bytes (nullptr for an empty file)
+    size_t size;      // number of mapped bytes
+#ifdef _WIN32
+    HANDLE fileHandle;    // handle of the open file
+    HANDLE mappingHandle; // handle of the file mapping object
+#endif
 
     /*
-     * Partition
-     *  Partition function for quicksort. Handles the actual swap sorting process.
+     * Unmap
+     *  Releases the mapping and any open handles, leaving the object empty
+     */
+    void Unmap() {
+#ifdef _WIN32
+        if (data != nullptr)
+            UnmapViewOfFile(data);
+        if (mappingHandle != nullptr)
+            CloseHandle(mappingHandle);
+        if (fileHandle != INVALID_HANDLE_VALUE)
+            CloseHandle(fileHandle);
+        mappingHandle = nullptr;
+        fileHandle = INVALID_HANDLE_VALUE;
+#else
+        if (data != nullptr)
+            munmap(const_cast<char*>(data), size);
+#endif
+        data = nullptr;
+        size = 0;
+    }
+
+public:
+    /*
+     * MappedFile
+     *  Class constructor
+     * Opens the file and maps its full contents read-only into memory.
      *
-     * @param vector<Course>& coursesVector - the vector of courses to be sorted
-     * @param size_t begin - the starting index to sort from
-     * @param size_t end - the end index to sort to
+     * @param const string& filePath - path and name of the file to map
      *
-     * @return int - returns the high value, to be used as the middle dividing value in subsequent calls
+     * @exception runtime_error is thrown if the file cannot be opened or mapped
      */
-    static int Partition(vector<Course>& coursesVector, size_t begin, size_t end) {
-        int low = static_cast<int>(begin);
-        int high = static_cast<int>(end);
-        int middlePoint = static_cast<int>(begin + ((end - begin) / 2));
+    explicit MappedFile(const string& filePath) : data(nullptr), size(0) {
+#ifdef _WIN32
+        mappingHandle = nullptr;
+        fileHandle = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                                 OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (fileHandle == INVALID_HANDLE_VALUE)
+            throw runtime_error("ERROR: Could not open file");
 
-        string pivot = coursesVector[middlePoint].courseNumber;
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(fileHandle, &fileSize)) {
+            Unmap();
+            throw runtime_error("ERROR: Could not read file size");
+        }
+        size = static_cast<size_t>(fileSize.QuadPart);
+        if (size == 0)
+            return; // nothing to map, an empty file is a valid empty view
 
-        while (true) {
-            while (coursesVector[low].courseNumber < pivot)
-                low++;
-            while (pivot < coursesVector[high].courseNumber)
-                high--;
+        mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mappingHandle != nullptr)
+            data = static_cast<const char*>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+        if (data == nullptr) {
+            Unmap();
+            throw runtime_error("ERROR: Could not map file");
+        }
+#else
+        int fileDescriptor = open(filePath.c_str(), O_RDONLY);
+        if (fileDescriptor < 0)
+            throw runtime_error("ERROR: Could not open file");
 
-            if (low >= high)
-                return high;
-            else {
-                swap(coursesVector[low], coursesVector[high]);
-                low++;
-                high--;
-            }
+        struct stat fileStatus;
+        if (fstat(fileDescriptor, &fileStatus) != 0) {
+            close(fileDescriptor);
+            throw runtime_error("ERROR: Could not read file size");
+        }
+        size = static_cast<size_t>(fileStatus.st_size);
+        if (size == 0) {
+            close(fileDescriptor);
+            return; // nothing to map, an empty file is a valid empty view
         }
 
-        return high;
+        void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+        close(fileDescriptor); // the mapping keeps its own reference to the file
+        if (mapping == MAP_FAILED) {
+            size = 0;
+            throw runtime_error("ERROR: Could not map file");
+        }
+        madvise(mapping, size, MADV_SEQUENTIAL); // the loader reads front to back
+        data = static_cast<const char*>(mapping);
+#endif
     }
 
     /*
-     * Quicksort
-     *  Recursive sort function for sorting a vector of courses
+     * MappedFile
+     *  Move constructor, takes ownership of another mapping
      *
-     * @param vector<Course>& coursesVector - the vector of courses to be sorted
-     * @param size_t begin - the starting index to sort from
-     * @param size_t end - the end index to sort to
+     * @param MappedFile&& other - mapping to take over, left empty afterward
      */
-    static void Quicksort(vector<Course>& coursesVector, size_t begin, size_t end) {
-        if (begin >= end)
-            return;
+    MappedFile(MappedFile&& other) noexcept : data(other.data), size(other.size) {
+#ifdef _WIN32
+        fileHandle = other.fileHandle;
+        mappingHandle = other.mappingHandle;
+        other.fileHandle = INVALID_HANDLE_VALUE;
+        other.mappingHandle = nullptr;
+#endif
+        other.data = nullptr;
+        other.size = 0;
+    }
 
-        size_t mid = Partition(coursesVector, begin, end);
-        Quicksort(coursesVector, begin, mid);
-        Quicksort(coursesVector, mid + 1, end);
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile& operator=(MappedFile&&) = delete;
+
+    /*
+     * ~MappedFile
+     *  Class destructor, unmaps the file
+     */
+    ~MappedFile() {
+        Unmap();
     }
 
     /*
-     * SortVector
-     *  Helper/wrapper function to start sorting a provided vector of courses.
-     * Check for empty vector and sets start and end properly.
-     * Use this function to initiate full-vector sorting.
+     * Data
+     *  Returns a pointer to the first mapped byte
      *
-     * @param vector<Course>& coursesVector - the vector of courses to be sorted
+     * @return const char* - start of the file contents (nullptr when the file is empty)
      */
-    static void SortVector(vector<Course>& coursesVector) {
-        if (coursesVector.empty())
-            return;
+    const char* Data() const {
+        return data;
+    }
 
-        Quicksort(coursesVector, 0, coursesVector.size() - 1);
+    /*
+     * Size
+     *  Returns the number of mapped bytes
+     *
+     * @return size_t - size of the file in bytes
+     */
+    size_t Size() const {
+        return size;
     }
+};
+
 
 /* *****************************
-* Vector Class - Public section
-***************************** */
+ * Utils Class
+ ***************************** */
+
+// Trim and uppercase utility function
+class Utils {
 public:
+
     /*
-     * Vector
-     *  Class constructor
-     * Initializes an empty course collection and sets the sorted flag to false.
-     */
-    Vector() {
-        courseCollection = vector<Course>();
-        isSorted = false;
+    * TrimAndUppercase
+    *  Trims leading and trailing spaces from the supplied string and coverts string to uppercase
+    *
+    * @param string_view stringField - string to trim and convert
+    *
+    * @return string - returns trimmed uppercase string
+    */
+    static string TrimAndUppercase(string_view stringField) {
+        string result;
+        TrimAndUppercaseInto(stringField, result); // builds the result once, instead of copying and taking a substring
+        return result;
     }
 
     /*
-     * IsValidCourseObject
-     *  Validates that a Course object contains required data
+     * TrimAndUppercaseInto
+     *  Same rules as TrimAndUppercase, but reads from a view of the raw input
+     * and writes into an existing string, so no temporary strings are created
      *
-     * Checks that the supplied Course pointer is not null and contains
-     * both a course number and name.
+     * @param string_view stringField - raw field to trim and convert
+     * @param string& result - destination, replaced with the trimmed uppercase field
+     */
+    static void TrimAndUppercaseInto(string_view stringField, string& result) {
+        size_t start = 0;
+        size_t end = stringField.length();
+
+        // Move the start forward and the end backward past spaces
+        while (start < end && stringField[start] == ' ') {
+            start++;
+        }
+        while (end > start && stringField[end - 1] == ' ') {
+            end--;
+        }
+
+        result.assign(stringField.data() + start, end - start);
+        for (char& character : result) {
+            character = static_cast<char>(toupper(static_cast<unsigned char>(character)));
+        }
+    }
+
+    /*
+     * NextLine
+     *  Steps to the next non-blank line of raw input, dropping a trailing carriage return
      *
-     * @param Course* course - pointer to the Course object to validate
+     * @param const char*& position - start of the unread input, moved past the line returned
+     * @param const char* end - one past the last byte of input
+     * @param string_view& line - set to the line found, without its line ending
      *
-     * @return bool - true if the Course object is valid; otherwise false
+     * @return bool - true if a line was found, false once the input is used up
      */
-    static bool IsValidCourseObject(Course* course) {
-        if (course == nullptr)
-            return false;
-        if (course->courseNumber.empty())
-            return false;
-        if (course->name.empty())
-            return false;
-        return true;
+    static bool NextLine(const char*& position, const char* end, string_view& line) {
+        while (position < end) {
+            const char* newline = static_cast<const char*>(memchr(position, '\n', end - position));
+            const char* lineEnd = (newline != nullptr) ? newline : end;
+            line = string_view(position, lineEnd - position);
+            position = (newline != nullptr) ? newline + 1 : end;
+
+            if (!line.empty() && line.back() == '\r')
+                line.remove_suffix(1);
+            if (line.find_first_not_of(' ') != string_view::npos)
+                return true;
+        }
+        return false;
     }
 
     /*
-     * IsEmpty
-     *  Indicates whether any courses have been loaded
-     *
-     * Returns true if the internal course collection contains no data.
+     * ReadAllStdin
+     *  Reads standard input to the end in large blocks, for modes that take "-" as their input file
      *
-     * @return bool - true if no courses are loaded; otherwise false
+     * @return string - everything read from standard input
      */
-    bool IsEmpty() const {
-        return courseCollection.empty();
+    static string ReadAllStdin() {
+        string input;
+        char block[1 << 16];
+        size_t bytesRead;
+        while ((bytesRead = fread(block, 1, sizeof(block), stdin)) > 0)
+            input.append(block, bytesRead);
+        return input;
     }
 
     /*
-     * ParseLineToCourse
-     *  Parses a single comma-separated line into a Course object
+     * OpenFile
+     *  Opens a file for reading
      *
-     * The first string field is treated as the course number, the second as the course name,
-     * and any remaining fields as prerequisites. Blank prerequisite fields are ignored.
+     * @param string filePath = "" - USes path and name supplied, or global default
      *
-     * @param const string& line - raw comma-separated line from the input file
+     * @return ifstream - returns opened file stream
      *
-     * @return Course* - pointer to a newly created Course object, or nullptr if the
-     *                   required fields are missing
+     * @exception runtime_error is thrown if file cannot be opened
      */
-    static Course* ParseLineToCourse(const string& line) {
-        stringstream stringStream(line);
-        string field;
-        vector<string> fields;
-
-        // convert the file, line by line, to a vector of raw string fields (omit the commas)
-        while (getline(stringStream, field, ',')) {
-            fields.push_back(field);
+    static ifstream OpenFile(string filePath = "") {
+        if (filePath.empty()) {
+            filePath = FILE_PATH;
         }
 
-        // If there are less than 2 fields, or fields 1 or 2 are empty, then exit
-        if (fields.size() < 2 || fields[0].empty() || fields[1].empty())
-            return nullptr;
-
-        Course* course = new Course();
-        course->courseNumber = Utils::TrimAndUppercase(fields[0]); // remove leading/traling spaces and covert to uppercase
-        //course->name = Utils::TrimAndUppercase(fields[1]);
-        course->name = fields[1]; // leading/trailing spaces do not matter for course names
-
-        // Add prerequisites, but skip blank ones
-        for (size_t i = 2; i < fields.size(); i++) {
-            if (!fields[i].empty()) {  // Do not add empty prerequisits
-                course->prerequisites.push_back(Utils::TrimAndUppercase(fields[i]));
-            }
+        ifstream file(filePath);
+        if (!file.is_open()) {
+            throw runtime_error("ERROR: Could not open file"); // throw an error if file cannot be opened
         }
-
-        return course;
+        return file;
     }
 
     /*
-     * Search
-     *  Performs a binary search for a course by course number
+     * MapFile
+     *  Maps a file read-only into memory
      *
-     * Locates a course in the collection using binary search. 
-     * Automatically sorts the collection first if it is not already sorted.
+     * @param string filePath = "" - Uses path and name supplied, or global default
      *
-     * @param const string& courseNumber - the course number to search for
+     * @return MappedFile - returns the mapped file contents
      *
-     * @return Course* - pointer to the matching Course if found; otherwise nullptr
+     * @exception runtime_error is thrown if file cannot be opened or mapped
      */
-    Course* Search(const string& courseNumber) {
-        if (!isSorted) {
-            SortVector(courseCollection);
-            isSorted = true;
+    static MappedFile MapFile(string filePath = "") {
+        if (filePath.empty()) {
+            filePath = FILE_PATH;
         }
 
-        int left = 0;
-        int right = static_cast<int>(courseCollection.size()) - 1;
-
-        while (left <= right) {
-            int middle = left + (right - left) / 2;
-            Course& middleCourse = courseCollection[middle];
+        return MappedFile(filePath);
+    }
 
-            if (middleCourse.courseNumber == courseNumber)
-                return &middleCourse;
+    /*
+     * ResolveThreadCount
+     *  Converts a requested thread count into the number of threads to actually use
+     *
+     * @param unsigned requested - requested thread count, 0 means one per hardware core
+     *
+     * @return unsigned - at least 1
+     */
+    static unsigned ResolveThreadCount(unsigned requested) {
+        if (requested == 0)
+            requested = thread::hardware_concurrency();
+        return max(requested, 1u);
+    }
 
-            if (courseNumber < middleCourse.courseNumber)
-                right = middle - 1;
-            else
-                left = middle + 1;
+    /*
+     * RunParallel
+     *  Runs task(0) through task(taskCount - 1) on a pool of worker threads
+     *
+     * Workers claim the next task index from a shared counter until all tasks are done.
+     * The calling thread acts as one of the workers, and the call returns when every task has finished.
+     *
+     * @param size_t taskCount - number of tasks to run
+     * @param unsigned threadCount - number of worker threads (0 uses all cores)
+     * @param const function<void(size_t)>& task - work to run for each task index
+     */
+    static void RunParallel(size_t taskCount, unsigned threadCount, const function<void(size_t)>& task) {
+        threadCount = static_cast<unsigned>(min<size_t>(ResolveThreadCount(threadCount), taskCount));
+        if (threadCount <= 1) {
+            for (size_t i = 0; i < taskCount; i++)
+                task(i);
+            return;
         }
 
-        return nullptr;
+        atomic<size_t> nextTask(0);
+        auto worker = [&]() {
+            for (size_t i = nextTask++; i < taskCount; i = nextTask++)
+                task(i);
+        };
+
+        vector<thread> workers;
+        for (unsigned i = 1; i < threadCount; i++)
+            workers.emplace_back(worker);
+        worker();
+        for (thread& workerThread : workers)
+            workerThread.join();
     }
 
     /*
-     * FindMissingPrerequisites
-     *  Scans all courses and verifies that each listed prerequisite exists.
-     * Returns the first course found that fails validation or nullptr if all courses are valid.
+     * LowestSetBit
+     *  Index of the lowest set bit in a non-zero 64-bit word
      *
-     * @return Course* - pointer to the first course found with a missing prerequisite,
-     *                   or nullptr if all prerequisites are valid
+     * @param uint64_t bits - word to scan, must not be zero
+     *
+     * @return unsigned - bit index, 0 to 63
      */
-    Course* FindMissingPrerequisites() {
-        for (Course& course : courseCollection) {
-            for (const string& prerequisite : course.prerequisites) {
-                if (Search(prerequisite) == nullptr) {
-                    return &course;
-                }
-            }
+    static unsigned LowestSetBit(uint64_t bits) {
+#if defined(_MSC_VER) && defined(_WIN64)
+        unsigned long index;
+        _BitScanForward64(&index, bits);
+        return static_cast<unsigned>(index);
+#elif defined(__GNUC__) || defined(__clang__)
+        return static_cast<unsigned>(__builtin_ctzll(bits));
+#else
+        unsigned index = 0;
+        while ((bits & 1) == 0) {
+            bits >>= 1;
+            index++;
         }
-        return nullptr;
+        return index;
+#endif
     }
 
     /*
-     * Insert
-     *  Adds a Course object to the collection
-     *
-     * Inserts a validated Course into the internal vector and marks the
-     * collection as unsorted.
+     * HighestSetBit
+     *  Index of the highest set bit in a non-zero 64-bit word
      *
-     * @param Course* course - pointer to the Course object to insert
+     * @param uint64_t bits - word to scan, must not be zero
      *
-     * @return bool - true if the course was inserted; otherwise false
+     * @return unsigned - bit index, 0 to 63
      */
-    bool Insert(Course* course) {
+    static unsigned HighestSetBit(uint64_t bits) {
+#if defined(_MSC_VER) && defined(_WIN64)
+        unsigned long index;
+        _BitScanReverse64(&index, bits);
+        return static_cast<unsigned>(index);
+#elif defined(__GNUC__) || defined(__clang__)
+        return 63u - static_cast<unsigned>(__builtin_clzll(bits));
+#else
+        unsigned index = 0;
+        while (bits >>= 1)
+            index++;
+        return index;
+#endif
+    }
+
+    /*
+     * Prefetch
+     *  Hints to the processor that the cache line holding an address will be read soon
+     *
+     * The address is never dereferenced, so it may lie past the end of an array.
+     *
+     * @param uintptr_t address - any address inside the cache line
+     */
+    static void Prefetch(uintptr_t address) {
+#if defined(__GNUC__) || defined(__clang__)
+        __builtin_prefetch(reinterpret_cast<const void*>(address));
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+        _mm_prefetch(reinterpret_cast<const char*>(address), _MM_HINT_T0);
+#else
+        (void)address;
+#endif
+    }
+
+    /*
+     * Checksum
+     *  64-bit checksum of a block of bytes, processed a word at a time
+     *
+     * @param const char* data - first byte to checksum
+     * @param size_t size - number of bytes
+     *
+     * @return uint64_t - checksum value
+     */
+    static uint64_t Checksum(const char* data, size_t size) {
+        const uint64_t MULTIPLIER = 0x9E3779B97F4A7C15ULL;
+        uint64_t hash = 0xCBF29CE484222325ULL ^ size;
+        size_t i = 0;
+        for (; i + 8 <= size; i += 8) {
+            uint64_t word;
+            memcpy(&word, data + i, sizeof(word));
+            hash = (hash ^ word) * MULTIPLIER;
+            hash ^= hash >> 29;
+        }
+        for (; i < size; i++) {
+            hash = (hash ^ static_cast<unsigned char>(data[i])) * MULTIPLIER;
+        }
+        return hash ^ (hash >> 32);
+    }
+
+    /*
+     * GetFileStamp
+     *  Reads the size and last modification time of a file, used to tell whether it has changed
+     *
+     * @param const string& filePath - file to check
+     * @param uint64_t& size - receives the file size in bytes
+     * @param int64_t& modified - receives the modification time in file-clock ticks
+     *
+     * @return bool - true if the file exists and both values were read; otherwise false
+     */
+    static bool GetFileStamp(const string& filePath, uint64_t& size, int64_t& modified) {
+        error_code error;
+        size = static_cast<uint64_t>(filesystem::file_size(filePath, error));
+        if (error)
+            return false;
+        modified = static_cast<int64_t>(filesystem::last_write_time(filePath, error).time_since_epoch().count());
+        return !error;
+    }
+
+    /*
+     * ResidentSetBytes
+     *  Reports the current resident set size (physical memory in use) of this process
+     *
+     * @return size_t - resident bytes, or 0 if the platform does not report it
+     */
+    static size_t ResidentSetBytes() {
+#ifdef _WIN32
+        PROCESS_MEMORY_COUNTERS counters;
+        if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+            return counters.WorkingSetSize;
+        return 0;
+#else
+        ifstream statm("/proc/self/statm");
+        size_t totalPages = 0;
+        size_t residentPages = 0;
+        if (!(statm >> totalPages >> residentPages))
+            return 0;
+        return residentPages * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+    }
+};
+
+
+/* *****************************
+ * Metrics Class
+ ***************************** */
+
+// Process-wide latency histograms, counters and gauges, exported as JSON or Prometheus text
+//
+// Recording costs a relaxed atomic add or two on a shard picked once per thread, so
+// threads rarely share cache lines and the instrumentation can stay on in production.
+// Latencies are measured with the monotonic steady clock in nanoseconds and kept in
+// log-linear buckets: four per power of two, so percentiles are within about 19%.
+class Metrics {
+public:
+    // Operations with a latency histogram
+    enum class Timing {
+        Load,       // parse, sort and index a catalog file
+        Reload,     // apply the differences of a changed catalog file
+        Sort,       // sort and re-index the course collection
+        Search,     // find one course by number and format it
+        Print,      // list the whole catalog
+        Analysis,   // prerequisite order, levels and transitive prerequisite queries
+        Range,      // prefix, range and autocomplete queries
+        NameSearch, // keyword search of course names
+        Plan,       // term schedule planning
+        Count       // number of timings, not a timing
+    };
+
+    // Monotonic event counts
+    enum class Counter {
+        Searches,     // course number lookups
+        SearchMisses, // lookups that found no course
+        LazySorts,    // sorts deferred until a query needed the sorted collection
+        Count         // number of counters, not a counter
+    };
+
+    // Values that are replaced rather than accumulated
+    enum class Gauge {
+        CatalogCourses, // courses in the most recently loaded catalog
+        CatalogBytes,   // memory used by the most recently loaded catalog
+        Count           // number of gauges, not a gauge
+    };
+
+    // Measures one operation and records it when stopped or destroyed
+    class Timer {
+    private:
+        Timing timing;     // histogram the latency goes to
+        uint64_t started;  // Now() at construction
+        bool isRecorded;   // flag to show if the latency has been recorded
+
+    public:
+        /*
+         * Timer
+         *  Class constructor, starts timing
+         *
+         * @param Timing operation - histogram to record into
+         */
+        explicit Timer(Timing operation) : timing(operation), started(Now()), isRecorded(false) {
+        }
+
+        Timer(const Timer&) = delete;
+        Timer& operator=(const Timer&) = delete;
+
+        /*
+         * ~Timer
+         *  Class destructor, records the latency if Stop() was not called
+         */
+        ~Timer() {
+            Stop();
+        }
+
+        /*
+         * Stop
+         *  Records the latency once and returns the time since construction
+         *
+         * @return double - elapsed wall time in seconds
+         */
+        double Stop() {
+            uint64_t elapsed = Now() - started;
+            if (!isRecorded) {
+                Record(timing, elapsed);
+                isRecorded = true;
+            }
+            return elapsed / 1e9;
+        }
+    };
+
+private:
+    static constexpr size_t TIMING_COUNT = static_cast<size_t>(Timing::Count);
+    static constexpr size_t COUNTER_COUNT = static_cast<size_t>(Counter::Count);
+    static constexpr size_t GAUGE_COUNT = static_cast<size_t>(Gauge::Count);
+    static constexpr size_t BUCKET_COUNT = 160; // buckets up to 2^40 ns (about 18 minutes)
+    static constexpr size_t SHARD_COUNT = 8;    // threads are spread over this many shards
+
+    // One thread group's share of every metric, on its own cache lines
+    struct alignas(64) Shard {
+        atomic<uint64_t> counters[COUNTER_COUNT];
+        atomic<uint64_t> buckets[TIMING_COUNT][BUCKET_COUNT];
+        atomic<uint64_t> totalNanoseconds[TIMING_COUNT];
+        atomic<uint64_t> maxNanoseconds[TIMING_COUNT];
+    };
+
+    // A timing's shards added together
+    struct Histogram {
+        uint64_t buckets[BUCKET_COUNT] = {}; // latencies per bucket
+        uint64_t count = 0;                  // number of latencies recorded
+        uint64_t totalNanoseconds = 0;       // sum of the latencies
+        uint64_t maxNanoseconds = 0;         // largest latency
+    };
+
+    inline static Shard shards[SHARD_COUNT];              // zero-initialized static storage
+    inline static atomic<size_t> nextShard{ 0 };          // shard handed to the next new thread
+    inline static atomic<uint64_t> gauges[GAUGE_COUNT];   // latest gauge values
+    inline static const uint64_t startTime = static_cast<uint64_t>(
+        chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count());
+    inline static string exitPath;                        // file written at exit, if any
+    inline static bool exitAsPrometheus = false;          // format of the file written at exit
+
+    inline static const char* TIMING_NAMES[TIMING_COUNT] = {
+        "load", "reload", "sort", "search", "print", "analysis", "range", "name_search", "plan" };
+    inline static const char* COUNTER_NAMES[COUNTER_COUNT] = { "searches", "search_misses", "lazy_sorts" };
+    inline static const char* COUNTER_HELP[COUNTER_COUNT] = {
+        "Course number lookups.", "Lookups that found no course.", "Sorts deferred until a query needed them." };
+    inline static const char* GAUGE_NAMES[GAUGE_COUNT] = { "catalog_courses", "catalog_bytes" };
+    inline static const char* GAUGE_HELP[GAUGE_COUNT] = {
+        "Courses in the most recently loaded catalog.", "Bytes used by the most recently loaded catalog." };
+
+    /*
+     * LocalShard
+     *  The calling thread's shard, assigned round robin on first use
+     *
+     * @return Shard& - shard to record into
+     */
+    static Shard& LocalShard() {
+        thread_local Shard* shard = &shards[nextShard.fetch_add(1, memory_order_relaxed) % SHARD_COUNT];
+        return *shard;
+    }
+
+    /*
+     * BucketOf
+     *  Histogram bucket of a latency: exact below 4 ns, then four buckets per power of two
+     *
+     * @param uint64_t nanoseconds - latency
+     *
+     * @return size_t - bucket index
+     */
+    static size_t BucketOf(uint64_t nanoseconds) {
+        if (nanoseconds < 4)
+            return static_cast<size_t>(nanoseconds);
+        unsigned highest = Utils::HighestSetBit(nanoseconds);
+        size_t bucket = 4 * (highest - 1) + ((nanoseconds >> (highest - 2)) & 3);
+        return min(bucket, BUCKET_COUNT - 1);
+    }
+
+    /*
+     * BucketLowerBound
+     *  Smallest latency that falls in a bucket
+     *
+     * @param size_t bucket - bucket index
+     *
+     * @return uint64_t - latency in nanoseconds
+     */
+    static uint64_t BucketLowerBound(size_t bucket) {
+        if (bucket < 4)
+            return bucket;
+        return (4 + bucket % 4) << (bucket / 4 - 1);
+    }
+
+    /*
+     * Collect
+     *  Adds up one timing's shards
+     *
+     * @param size_t timing - timing index
+     *
+     * @return Histogram - the combined histogram
+     */
+    static Histogram Collect(size_t timing) {
+        Histogram histogram;
+        for (const Shard& shard : shards) {
+            for (size_t b = 0; b < BUCKET_COUNT; b++) {
+                uint64_t count = shard.buckets[timing][b].load(memory_order_relaxed);
+                histogram.buckets[b] += count;
+                histogram.count += count;
+            }
+            histogram.totalNanoseconds += shard.totalNanoseconds[timing].load(memory_order_relaxed);
+            histogram.maxNanoseconds = max(histogram.maxNanoseconds, shard.maxNanoseconds[timing].load(memory_order_relaxed));
+        }
+        return histogram;
+    }
+
+    /*
+     * Percentile
+     *  Estimates a percentile as the upper edge of the bucket that holds it
+     *
+     * @param const Histogram& histogram - combined histogram
+     * @param double fraction - percentile as a fraction, e.g. 0.99
+     *
+     * @return uint64_t - latency in nanoseconds, never above the recorded maximum
+     */
+    static uint64_t Percentile(const Histogram& histogram, double fraction) {
+        if (histogram.count == 0)
+            return 0;
+        uint64_t rank = max<uint64_t>(static_cast<uint64_t>(ceil(fraction * histogram.count)), 1);
+        uint64_t seen = 0;
+        for (size_t b = 0; b + 1 < BUCKET_COUNT; b++) {
+            seen += histogram.buckets[b];
+            if (seen >= rank)
+                return min(BucketLowerBound(b + 1) - 1, histogram.maxNanoseconds);
+        }
+        return histogram.maxNanoseconds;
+    }
+
+    /*
+     * CounterTotal
+     *  Adds up one counter's shards
+     *
+     * @param size_t counter - counter index
+     *
+     * @return uint64_t - total count
+     */
+    static uint64_t CounterTotal(size_t counter) {
+        uint64_t total = 0;
+        for (const Shard& shard : shards)
+            total += shard.counters[counter].load(memory_order_relaxed);
+        return total;
+    }
+
+    /*
+     * WriteOnExit
+     *  atexit handler that writes the report requested with ExportAtExit
+     */
+    static void WriteOnExit() {
+        ofstream report(exitPath, ios::trunc);
+        if (exitAsPrometheus)
+            WritePrometheus(report);
+        else
+            WriteJson(report);
+    }
+
+public:
+    /*
+     * Now
+     *  Reads the monotonic high-resolution clock
+     *
+     * @return uint64_t - nanoseconds since an arbitrary fixed point
+     */
+    static uint64_t Now() {
+        return static_cast<uint64_t>(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    /*
+     * Record
+     *  Adds one latency to a timing's histogram
+     *
+     * @param Timing timing - operation that was measured
+     * @param uint64_t nanoseconds - its latency
+     */
+    static void Record(Timing timing, uint64_t nanoseconds) {
+        Shard& shard = LocalShard();
+        size_t t = static_cast<size_t>(timing);
+        shard.buckets[t][BucketOf(nanoseconds)].fetch_add(1, memory_order_relaxed);
+        shard.totalNanoseconds[t].fetch_add(nanoseconds, memory_order_relaxed);
+        uint64_t largest = shard.maxNanoseconds[t].load(memory_order_relaxed);
+        while (nanoseconds > largest && !shard.maxNanoseconds[t].compare_exchange_weak(largest, nanoseconds, memory_order_relaxed)) {
+        }
+    }
+
+    /*
+     * Increment
+     *  Adds to a counter
+     *
+     * @param Counter counter - counter to add to
+     * @param uint64_t amount = 1 - amount to add
+     */
+    static void Increment(Counter counter, uint64_t amount = 1) {
+        LocalShard().counters[static_cast<size_t>(counter)].fetch_add(amount, memory_order_relaxed);
+    }
+
+    /*
+     * Set
+     *  Replaces a gauge's value
+     *
+     * @param Gauge gauge - gauge to set
+     * @param uint64_t value - new value
+     */
+    static void Set(Gauge gauge, uint64_t value) {
+        gauges[static_cast<size_t>(gauge)].store(value, memory_order_relaxed);
+    }
+
+    /*
+     * ExportAtExit
+     *  Arranges for a report to be written to a file when the program exits
+     *
+     * @param const string& filePath - file to write
+     * @param bool asPrometheus - Prometheus text format instead of JSON
+     */
+    static void ExportAtExit(const string& filePath, bool asPrometheus) {
+        bool isRegistered = !exitPath.empty();
+        exitPath = filePath;
+        exitAsPrometheus = asPrometheus;
+        if (!isRegistered)
+            atexit(WriteOnExit);
+    }
+
+    /*
+     * WriteJson
+     *  Writes every metric as one JSON object
+     *
+     * @param ostream& output - stream to write to
+     */
+    static void WriteJson(ostream& output) {
+        output << "{\n  \"uptime_seconds\": " << (Now() - startTime) / 1e9 << ",\n  \"counters\": {";
+        for (size_t c = 0; c < COUNTER_COUNT; c++)
+            output << (c == 0 ? "" : ", ") << "\"" << COUNTER_NAMES[c] << "\": " << CounterTotal(c);
+        if (AllocationCounter::IS_ENABLED)
+            output << ", \"allocations\": " << AllocationCounter::Allocations() << ", \"allocated_bytes\": " << AllocationCounter::Bytes();
+        output << "},\n";
+        output << "  \"gauges\": {";
+        for (size_t g = 0; g < GAUGE_COUNT; g++)
+            output << "\"" << GAUGE_NAMES[g] << "\": " << gauges[g].load(memory_order_relaxed) << ", ";
+        output << "\"resident_bytes\": " << Utils::ResidentSetBytes() << "},\n";
+        output << "  \"latency_ns\": {\n";
+        for (size_t t = 0; t < TIMING_COUNT; t++) {
+            Histogram histogram = Collect(t);
+            output << "    \"" << TIMING_NAMES[t] << "\": {\"count\": " << histogram.count
+                   << ", \"mean\": " << (histogram.count == 0 ? 0 : histogram.totalNanoseconds / histogram.count)
+                   << ", \"p50\": " << Percentile(histogram, 0.50) << ", \"p90\": " << Percentile(histogram, 0.90)
+                   << ", \"p99\": " << Percentile(histogram, 0.99) << ", \"max\": " << histogram.maxNanoseconds << "}"
+                   << (t + 1 < TIMING_COUNT ? ",\n" : "\n");
+        }
+        output << "  }\n}\n";
+    }
+
+    /*
+     * WritePrometheus
+     *  Writes every metric in the Prometheus text exposition format
+     *
+     * Latency buckets are reported at each power of two from 256 ns to about 69 s.
+     *
+     * @param ostream& output - stream to write to
+     */
+    static void WritePrometheus(ostream& output) {
+        for (size_t c = 0; c < COUNTER_COUNT; c++) {
+            output << "# HELP course_planner_" << COUNTER_NAMES[c] << "_total " << COUNTER_HELP[c] << "\n"
+                   << "# TYPE course_planner_" << COUNTER_NAMES[c] << "_total counter\n"
+                   << "course_planner_" << COUNTER_NAMES[c] << "_total " << CounterTotal(c) << "\n";
+        }
+        if (AllocationCounter::IS_ENABLED) {
+            output << "# HELP course_planner_allocations_total Heap allocations.\n"
+                   << "# TYPE course_planner_allocations_total counter\n"
+                   << "course_planner_allocations_total " << AllocationCounter::Allocations() << "\n"
+                   << "# HELP course_planner_allocated_bytes_total Bytes requested from the heap.\n"
+                   << "# TYPE course_planner_allocated_bytes_total counter\n"
+                   << "course_planner_allocated_bytes_total " << AllocationCounter::Bytes() << "\n";
+        }
+        for (size_t g = 0; g < GAUGE_COUNT; g++) {
+            output << "# HELP course_planner_" << GAUGE_NAMES[g] << " " << GAUGE_HELP[g] << "\n"
+                   << "# TYPE course_planner_" << GAUGE_NAMES[g] << " gauge\n"
+                   << "course_planner_" << GAUGE_NAMES[g] << " " << gauges[g].load(memory_order_relaxed) << "\n";
+        }
+        output << "# HELP course_planner_resident_bytes Resident memory of the process.\n"
+               << "# TYPE course_planner_resident_bytes gauge\n"
+               << "course_planner_resident_bytes " << Utils::ResidentSetBytes() << "\n";
+
+        output << "# HELP course_planner_latency_seconds Wall time of catalog operations.\n"
+               << "# TYPE course_planner_latency_seconds histogram\n";
+        for (size_t t = 0; t < TIMING_COUNT; t++) {
+            Histogram histogram = Collect(t);
+            uint64_t below = 0;
+            size_t bucket = 0;
+            for (unsigned power = 8; power <= 36; power++) {
+                for (; bucket < 4 * (power - 1); bucket++)
+                    below += histogram.buckets[bucket];
+                output << "course_planner_latency_seconds_bucket{operation=\"" << TIMING_NAMES[t] << "\",le=\""
+                       << static_cast<double>(uint64_t(1) << power) / 1e9 << "\"} " << below << "\n";
+            }
+            output << "course_planner_latency_seconds_bucket{operation=\"" << TIMING_NAMES[t] << "\",le=\"+Inf\"} " << histogram.count << "\n"
+                   << "course_planner_latency_seconds_sum{operation=\"" << TIMING_NAMES[t] << "\"} " << histogram.totalNanoseconds / 1e9 << "\n"
+                   << "course_planner_latency_seconds_count{operation=\"" << TIMING_NAMES[t] << "\"} " << histogram.count << "\n";
+        }
+    }
+};
+
+
+/* *****************************
+ * StringArena Class
+ ***************************** */
+
+// Monotonic arena holding the text of a catalog's courses in large blocks
+//
+// Course fields are views into these blocks, so a parsed line costs no allocations
+// of its own: a new block is taken only when the current one is full. Blocks are
+// reference counted, so copies of a catalog share the text they were copied with,
+// and every copy appends only to blocks of its own.
+class StringArena {
+private:
+    static constexpr size_t BLOCK_SIZE = 1 << 16; // bytes in a standard block
+
+    vector<shared_ptr<char[]>> blocks; // every block whose text is referenced by this arena's owner
+    char* cursor;                      // next free byte of the current block, which only this arena writes to
+    size_t remaining;                  // free bytes left in the current block
+    size_t reservedBytes;              // total size of all blocks
+
+public:
+    /*
+     * StringArena
+     *  Class constructor, creates an empty arena (no block is taken until the first store)
+     */
+    StringArena() : cursor(nullptr), remaining(0), reservedBytes(0) {
+    }
+
+    /*
+     * StringArena
+     *  Copy constructor; shares the other arena's blocks, and starts its own block for new text
+     */
+    StringArena(const StringArena& other) : blocks(other.blocks), cursor(nullptr), remaining(0), reservedBytes(other.reservedBytes) {
+    }
+
+    /*
+     * StringArena
+     *  Move constructor; takes the other arena's blocks and leaves it empty
+     */
+    StringArena(StringArena&& other) noexcept
+        : blocks(move(other.blocks)), cursor(other.cursor), remaining(other.remaining), reservedBytes(other.reservedBytes) {
+        other.blocks.clear();
+        other.cursor = nullptr;
+        other.remaining = 0;
+        other.reservedBytes = 0;
+    }
+
+    StringArena& operator=(const StringArena& other) {
+        if (this != &other) {
+            blocks = other.blocks;
+            cursor = nullptr;
+            remaining = 0;
+            reservedBytes = other.reservedBytes;
+        }
+        return *this;
+    }
+
+    StringArena& operator=(StringArena&& other) noexcept {
+        if (this != &other) {
+            blocks = move(other.blocks);
+            cursor = other.cursor;
+            remaining = other.remaining;
+            reservedBytes = other.reservedBytes;
+            other.blocks.clear();
+            other.cursor = nullptr;
+            other.remaining = 0;
+            other.reservedBytes = 0;
+        }
+        return *this;
+    }
+
+    /*
+     * Allocate
+     *  Reserves uninitialized space, taking a new block if the current one is too full
+     *
+     * @param size_t size - bytes needed
+     * @param size_t alignment = 1 - required alignment, a power of two
+     *
+     * @return char* - the reserved space
+     */
+    char* Allocate(size_t size, size_t alignment = 1) {
+        size_t padding = (alignment - reinterpret_cast<uintptr_t>(cursor) % alignment) % alignment;
+        if (cursor == nullptr || padding + size > remaining) {
+            size_t blockSize = max(BLOCK_SIZE, size + alignment);
+            blocks.emplace_back(new char[blockSize]);
+            reservedBytes += blockSize;
+            cursor = blocks.back().get();
+            remaining = blockSize;
+            padding = (alignment - reinterpret_cast<uintptr_t>(cursor) % alignment) % alignment;
+        }
+        char* result = cursor + padding;
+        cursor += padding + size;
+        remaining -= padding + size;
+        return result;
+    }
+
+    /*
+     * Store
+     *  Copies text into the arena
+     *
+     * @param string_view text - text to copy
+     *
+     * @return string_view - view of the stored copy
+     */
+    string_view Store(string_view text) {
+        if (text.empty())
+            return string_view();
+        char* destination = Allocate(text.size());
+        memcpy(destination, text.data(), text.size());
+        return string_view(destination, text.size());
+    }
+
+    /*
+     * StoreTrimmedUppercase
+     *  Copies text into the arena without leading/trailing spaces and converted to uppercase,
+     * in the same single pass (the in-place form of Utils::TrimAndUppercase)
+     *
+     * @param string_view text - text to copy
+     *
+     * @return string_view - view of the stored copy
+     */
+    string_view StoreTrimmedUppercase(string_view text) {
+        size_t first = text.find_first_not_of(' ');
+        if (first == string_view::npos)
+            return string_view();
+        size_t last = text.find_last_not_of(' ');
+        text = text.substr(first, last - first + 1);
+
+        char* destination = Allocate(text.size());
+        for (size_t i = 0; i < text.size(); i++)
+            destination[i] = static_cast<char>(toupper(static_cast<unsigned char>(text[i])));
+        return string_view(destination, text.size());
+    }
+
+    /*
+     * Adopt
+     *  Shares another arena's blocks, so views into them stay valid as long as this arena lives
+     *
+     * @param const StringArena& other - arena whose text is now also referenced here
+     */
+    void Adopt(const StringArena& other) {
+        blocks.insert(blocks.end(), other.blocks.begin(), other.blocks.end());
+        reservedBytes += other.reservedBytes;
+    }
+
+    /*
+     * Clear
+     *  Releases this arena's references to every block
+     */
+    void Clear() {
+        blocks.clear();
+        cursor = nullptr;
+        remaining = 0;
+        reservedBytes = 0;
+    }
+
+    /*
+     * MemoryFootprint
+     *  Bytes of all blocks referenced by this arena
+     *
+     * @return size_t - heap bytes
+     */
+    size_t MemoryFootprint() const {
+        return reservedBytes + blocks.capacity() * sizeof(shared_ptr<char[]>);
+    }
+};
+
+
+/* *****************************
+ * CourseKey Class
+ ***************************** */
+
+// Packs course numbers of up to 8 characters into 64-bit integer keys
+class CourseKey {
+public:
+    static const size_t MAX_LENGTH = 8; // longest course number that fits in a key
+
+    /*
+     * Pack
+     *  Encodes a course number as a big-endian, zero-padded 64-bit integer
+     *
+     * Comparing two packed keys as integers gives the same order as comparing
+     * the original strings, so keys can be sorted and searched directly.
+     *
+     * @param string_view courseNumber - course number to encode
+     * @param uint64_t& key - receives the packed key
+     *
+     * @return bool - true if the course number fits (1 to 8 characters, no NUL bytes); otherwise false
+     */
+    static bool Pack(string_view courseNumber, uint64_t& key) {
+        if (courseNumber.empty() || courseNumber.length() > MAX_LENGTH)
+            return false;
+
+        key = 0;
+        for (size_t i = 0; i < MAX_LENGTH; i++) {
+            unsigned char character = (i < courseNumber.length()) ? static_cast<unsigned char>(courseNumber[i]) : 0;
+            if (i < courseNumber.length() && character == 0)
+                return false;
+            key = (key << 8) | character;
+        }
+        return true;
+    }
+
+    /*
+     * Unpack
+     *  Decodes a packed key back into its course number
+     *
+     * @param uint64_t key - packed key
+     *
+     * @return string - the original course number
+     */
+    static string Unpack(uint64_t key) {
+        string courseNumber;
+        for (int shift = 56; shift >= 0; shift -= 8) {
+            char character = static_cast<char>((key >> shift) & 0xFF);
+            if (character == 0)
+                break;
+            courseNumber += character;
+        }
+        return courseNumber;
+    }
+};
+
+
+/* *****************************
+ * KeySearchIndex Class
+ ***************************** */
+
+// Read-only search index over a sorted array of packed course keys, stored in a cache-friendly order
+class KeySearchIndex {
+private:
+    static constexpr size_t LINE_KEYS = 8;                 // keys per 64-byte cache line, and per B-tree node
+    static constexpr size_t LINE_BYTES = 64;               // cache line size the layouts are aligned to
+    static constexpr int64_t FILLER = INT64_MAX;           // pads the last B-tree nodes, never less than a query
+    static constexpr uint64_t SIGN_BIT = 1ULL << 63;       // flipped so keys compare correctly as signed integers
+
+    SearchLayout layout;     // layout in use
+    const uint64_t* sorted;  // the sorted keys the index was built over, not owned
+    size_t count;            // number of keys
+    vector<int64_t> storage; // Eytzinger or B-tree keys (sign bit flipped), with room to align them
+    int64_t* tree;           // first key of the layout, aligned to a cache line
+    vector<uint32_t> ranks;  // position in sorted of the key in each tree slot
+    size_t nodeCount;        // number of B-tree nodes
+
+    /*
+     * ToSigned
+     *  Flips the sign bit so that signed comparison gives the unsigned key order,
+     * which is what the SIMD compare instructions provide
+     *
+     * @param uint64_t key - packed key
+     *
+     * @return int64_t - key in signed order
+     */
+    static int64_t ToSigned(uint64_t key) {
+        return static_cast<int64_t>(key ^ SIGN_BIT);
+    }
+
+    /*
+     * AllocateTree
+     *  Sizes storage and ranks for slotCount slots and aligns tree to a cache line
+     *
+     * @param size_t slotCount - number of key slots in the layout
+     */
+    void AllocateTree(size_t slotCount) {
+        storage.assign(slotCount + LINE_BYTES / sizeof(int64_t), FILLER);
+        ranks.assign(slotCount, static_cast<uint32_t>(count));
+        uintptr_t address = reinterpret_cast<uintptr_t>(storage.data());
+        size_t misalignment = address % LINE_BYTES;
+        tree = storage.data() + ((misalignment == 0) ? 0 : (LINE_BYTES - misalignment) / sizeof(int64_t));
+    }
+
+    /*
+     * FillEytzinger
+     *  Places the keys in Eytzinger order by an in-order walk of the implicit tree
+     * (node k has children 2k and 2k + 1, the root is slot 1)
+     *
+     * @param size_t next - position in sorted of the next key to place
+     * @param size_t node - tree slot to fill
+     *
+     * @return size_t - position of the next key after this subtree
+     */
+    size_t FillEytzinger(size_t next, size_t node) {
+        if (node <= count) {
+            next = FillEytzinger(next, 2 * node);
+            tree[node] = ToSigned(sorted[next]);
+            ranks[node] = static_cast<uint32_t>(next++);
+            next = FillEytzinger(next, 2 * node + 1);
+        }
+        return next;
+    }
+
+    /*
+     * FillBTree
+     *  Places the keys in B-tree order by an in-order walk of the implicit tree
+     * (node b holds slots 8b to 8b + 7, its children are nodes 9b + 1 to 9b + 9)
+     *
+     * @param size_t next - position in sorted of the next key to place
+     * @param size_t node - node to fill
+     *
+     * @return size_t - position of the next key after this subtree
+     */
+    size_t FillBTree(size_t next, size_t node) {
+        if (node < nodeCount) {
+            for (size_t i = 0; i < LINE_KEYS; i++) {
+                next = FillBTree(next, node * (LINE_KEYS + 1) + i + 1);
+                if (next < count) {
+                    tree[node * LINE_KEYS + i] = ToSigned(sorted[next]);
+                    ranks[node * LINE_KEYS + i] = static_cast<uint32_t>(next++);
+                }
+            }
+            next = FillBTree(next, node * (LINE_KEYS + 1) + LINE_KEYS + 1);
+        }
+        return next;
+    }
+
+    /*
+     * CountLess
+     *  Number of keys in a B-tree node that are less than the target. Node keys are
+     * sorted, so this is also the index of the first key not less than the target.
+     *
+     * Compares all eight keys at once with AVX2 or SSE4.2 when the build enables them,
+     * otherwise with a branch-free scalar loop.
+     *
+     * @param const int64_t* node - the node's eight keys, cache-line aligned
+     * @param int64_t target - query key in signed order
+     *
+     * @return unsigned - 0 to 8
+     */
+    static unsigned CountLess(const int64_t* node, int64_t target) {
+#if defined(__AVX2__)
+        __m256i value = _mm256_set1_epi64x(target);
+        __m256i lessLow = _mm256_cmpgt_epi64(value, _mm256_load_si256(reinterpret_cast<const __m256i*>(node)));
+        __m256i lessHigh = _mm256_cmpgt_epi64(value, _mm256_load_si256(reinterpret_cast<const __m256i*>(node + 4)));
+        uint64_t mask = static_cast<uint64_t>(_mm256_movemask_pd(_mm256_castsi256_pd(lessLow)))
+            | (static_cast<uint64_t>(_mm256_movemask_pd(_mm256_castsi256_pd(lessHigh))) << 4);
+        return Utils::LowestSetBit(~mask);
+#elif defined(__SSE4_2__)
+        __m128i value = _mm_set1_epi64x(target);
+        uint64_t mask = 0;
+        for (size_t i = 0; i < LINE_KEYS; i += 2) {
+            __m128i less = _mm_cmpgt_epi64(value, _mm_load_si128(reinterpret_cast<const __m128i*>(node + i)));
+            mask |= static_cast<uint64_t>(_mm_movemask_pd(_mm_castsi128_pd(less))) << i;
+        }
+        return Utils::LowestSetBit(~mask);
+#else
+        // Branch-free binary search of the node: each step halves the range the answer lies in
+        unsigned less = (node[3] < target) ? 4 : 0;
+        less += (node[less + 1] < target) ? 2 : 0;
+        less += (node[less] < target) ? 1 : 0;
+        less += (node[less] < target) ? 1 : 0;
+        return less;
+#endif
+    }
+
+    /*
+     * FindEytzinger
+     *  Branch-free descent of the Eytzinger layout
+     *
+     * Each step moves to child 2k or 2k + 1 depending on one comparison, with no
+     * branch to mispredict. The 16 descendants four levels down occupy two aligned
+     * cache lines, which are prefetched so later levels are already on their way.
+     *
+     * @param int64_t target - query key in signed order
+     *
+     * @return size_t - tree slot of the first key not less than the target, or 0 if there is none
+     */
+    size_t FindEytzinger(int64_t target) const {
+        uintptr_t base = reinterpret_cast<uintptr_t>(tree);
+        size_t node = 1;
+        while (node <= count) {
+            Utils::Prefetch(base + node * 16 * sizeof(int64_t));
+            Utils::Prefetch(base + node * 16 * sizeof(int64_t) + LINE_BYTES);
+            node = 2 * node + (tree[node] < target);
+        }
+        // Undo the trailing right turns plus the final left turn to reach the answer
+        return node >> (Utils::LowestSetBit(~static_cast<uint64_t>(node)) + 1);
+    }
+
+    /*
+     * FindBTree
+     *  Descent of the B-tree layout, one cache line per level
+     *
+     * @param int64_t target - query key in signed order
+     *
+     * @return size_t - tree slot of the first key not less than the target, or SIZE_MAX if there is none
+     */
+    size_t FindBTree(int64_t target) const {
+        size_t slot = SIZE_MAX;
+        size_t node = 0;
+        while (node < nodeCount) {
+            unsigned less = CountLess(tree + node * LINE_KEYS, target);
+            slot = (less < LINE_KEYS) ? node * LINE_KEYS + less : slot;
+            node = node * (LINE_KEYS + 1) + less + 1;
+        }
+        return slot;
+    }
+
+public:
+    /*
+     * KeySearchIndex
+     *  Class constructor, creates an empty index
+     */
+    KeySearchIndex() : layout(SearchLayout::Binary), sorted(nullptr), count(0), tree(nullptr), nodeCount(0) {
+    }
+
+    KeySearchIndex(const KeySearchIndex&) = delete;
+    KeySearchIndex& operator=(const KeySearchIndex&) = delete;
+
+    /*
+     * Build
+     *  Builds the index over a sorted key array in the requested layout
+     *
+     * The Binary layout searches the array in place and copies nothing. The other layouts
+     * copy the keys, so the array only has to outlive the index to confirm matches.
+     *
+     * @param const uint64_t* sortedKeys - keys in ascending order, must stay valid while the index is used
+     * @param size_t keyCount - number of keys
+     * @param SearchLayout newLayout - layout to build
+     */
+    void Build(const uint64_t* sortedKeys, size_t keyCount, SearchLayout newLayout) {
+        Clear();
+        sorted = sortedKeys;
+        count = keyCount;
+        layout = (keyCount < UINT32_MAX) ? newLayout : SearchLayout::Binary; // ranks are 32-bit
+
+        if (layout == SearchLayout::Eytzinger) {
+            AllocateTree(count + 1);
+            FillEytzinger(0, 1);
+        }
+        else if (layout == SearchLayout::BTree) {
+            nodeCount = (count + LINE_KEYS - 1) / LINE_KEYS;
+            AllocateTree(nodeCount * LINE_KEYS);
+            FillBTree(0, 0);
+        }
+    }
+
+    /*
+     * Clear
+     *  Empties the index and releases its storage
+     */
+    void Clear() {
+        layout = SearchLayout::Binary;
+        sorted = nullptr;
+        count = 0;
+        vector<int64_t>().swap(storage);
+        vector<uint32_t>().swap(ranks);
+        tree = nullptr;
+        nodeCount = 0;
+    }
+
+    /*
+     * Find
+     *  Looks up a packed key
+     *
+     * @param uint64_t key - packed course number
+     *
+     * @return size_t - position of the key in the sorted array, or SIZE_MAX if it is not present
+     */
+    size_t Find(uint64_t key) const {
+        // The layouts confirm a match from the slot they stopped at, which is already in cache
+        if (layout == SearchLayout::Eytzinger) {
+            size_t node = FindEytzinger(ToSigned(key));
+            return (node != 0 && tree[node] == ToSigned(key)) ? ranks[node] : SIZE_MAX;
+        }
+        if (layout == SearchLayout::BTree) {
+            size_t slot = FindBTree(ToSigned(key));
+            return (slot != SIZE_MAX && tree[slot] == ToSigned(key)) ? ranks[slot] : SIZE_MAX;
+        }
+
+        const uint64_t* found = lower_bound(sorted, sorted + count, key);
+        if (found == sorted + count || *found != key)
+            return SIZE_MAX;
+        return static_cast<size_t>(found - sorted);
+    }
+
+    /*
+     * Layout
+     *  Layout the index was built in
+     *
+     * @return SearchLayout - Binary, Eytzinger or BTree
+     */
+    SearchLayout Layout() const {
+        return layout;
+    }
+
+    /*
+     * LayoutName
+     *  Lower-case name of a layout, as accepted by the --search-layout option
+     *
+     * @param SearchLayout searchLayout - layout to name
+     *
+     * @return const char* - "binary", "eytzinger" or "btree"
+     */
+    static const char* LayoutName(SearchLayout searchLayout) {
+        if (searchLayout == SearchLayout::Eytzinger)
+            return "eytzinger";
+        if (searchLayout == SearchLayout::BTree)
+            return "btree";
+        return "binary";
+    }
+
+    /*
+     * MemoryFootprint
+     *  Bytes held by the layout copy of the keys and their ranks
+     *
+     * @return size_t - allocated bytes
+     */
+    size_t MemoryFootprint() const {
+        return storage.capacity() * sizeof(int64_t) + ranks.capacity() * sizeof(uint32_t);
+    }
+};
+
+
+/* *****************************
+ * CourseHashIndex Class
+ ***************************** */
+
+// Open-addressing (linear probing) hash index from course number to a position in a course vector
+class CourseHashIndex {
+private:
+    // One table slot; position 0 marks an empty slot, so positions are stored plus one
+    struct Slot {
+        uint32_t hash;     // low bits of the key hash, compared before touching the course
+        uint32_t position; // position in the course vector plus one, or 0 if empty
+    };
+
+    vector<Slot> slots; // table, size is always zero or a power of two
+    size_t mask;        // slots.size() - 1, used to wrap probe positions
+    size_t used;        // number of occupied slots
+
+    /*
+     * Grow
+     *  Doubles the table (or allocates the first one) and reinserts every entry
+     *
+     * @param size_t minimumSlots - the new table will have at least this many slots
+     */
+    void Grow(size_t minimumSlots) {
+        size_t capacity = 16;
+        while (capacity < minimumSlots)
+            capacity *= 2;
+
+        vector<Slot> oldSlots = move(slots);
+        slots.assign(capacity, Slot{ 0, 0 });
+        mask = capacity - 1;
+        for (const Slot& slot : oldSlots) {
+            if (slot.position == 0)
+                continue;
+            size_t probe = slot.hash & mask;
+            while (slots[probe].position != 0)
+                probe = (probe + 1) & mask;
+            slots[probe] = slot;
+        }
+    }
+
+public:
+    /*
+     * CourseHashIndex
+     *  Class constructor, creates an empty index
+     */
+    CourseHashIndex() : mask(0), used(0) {
+    }
+
+    /*
+     * Hash
+     *  FNV-1a hash of a course number
+     *
+     * @param string_view courseNumber - key to hash
+     *
+     * @return uint32_t - hash value
+     */
+    static uint32_t Hash(string_view courseNumber) {
+        uint64_t hash = 14695981039346656037ULL;
+        for (char character : courseNumber) {
+            hash ^= static_cast<unsigned char>(character);
+            hash *= 1099511628211ULL;
+        }
+        return static_cast<uint32_t>(hash ^ (hash >> 32));
+    }
+
+    /*
+     * Clear
+     *  Removes every entry, keeping the table allocated
+     */
+    void Clear() {
+        fill(slots.begin(), slots.end(), Slot{ 0, 0 });
+        used = 0;
+    }
+
+    /*
+     * Reserve
+     *  Sizes the table so that entryCount entries fit without growing
+     *
+     * @param size_t entryCount - expected number of entries
+     */
+    void Reserve(size_t entryCount) {
+        if (entryCount * 2 > slots.size())
+            Grow(entryCount * 2);
+    }
+
+    /*
+     * Insert
+     *  Adds a course number at the given position. If the number is already
+     * indexed the existing entry is kept, so lookups return the first one added.
+     *
+     * @param const vector<Course>& courses - the vector the positions refer to
+     * @param size_t position - position of the course to index
+     *
+     * @return bool - true if a new entry was added; otherwise false
+     */
+    bool Insert(const vector<Course>& courses, size_t position) {
+        // Keep the load factor at or below one half
+        if ((used + 1) * 2 > slots.size())
+            Grow((used + 1) * 2);
+
+        string_view courseNumber = courses[position].courseNumber;
+        uint32_t hash = Hash(courseNumber);
+        size_t probe = hash & mask;
+        while (slots[probe].position != 0) {
+            if (slots[probe].hash == hash && courses[slots[probe].position - 1].courseNumber == courseNumber)
+                return false;
+            probe = (probe + 1) & mask;
+        }
+
+        slots[probe] = Slot{ hash, static_cast<uint32_t>(position + 1) };
+        used++;
+        return true;
+    }
+
+    /*
+     * Erase
+     *  Removes the entry of the course at a position, if it is the one indexed for its number
+     *
+     * Later entries of the same probe run are shifted back into the gap (backward-shift
+     * deletion), so no tombstones are left and lookups still stop at the first empty slot.
+     *
+     * @param const vector<Course>& courses - the vector the positions refer to
+     * @param size_t position - position of the course to remove
+     *
+     * @return bool - true if an entry was removed; otherwise false
+     */
+    bool Erase(const vector<Course>& courses, size_t position) {
+        if (used == 0)
+            return false;
+
+        uint32_t hash = Hash(courses[position].courseNumber);
+        size_t hole = hash & mask;
+        while (slots[hole].position != position + 1) {
+            if (slots[hole].position == 0)
+                return false;
+            hole = (hole + 1) & mask;
+        }
+
+        // An entry may fill the hole unless its home slot lies after the hole in the run
+        size_t next = (hole + 1) & mask;
+        while (slots[next].position != 0) {
+            size_t home = slots[next].hash & mask;
+            if (((next - home) & mask) >= ((next - hole) & mask)) {
+                slots[hole] = slots[next];
+                hole = next;
+            }
+            next = (next + 1) & mask;
+        }
+        slots[hole] = Slot{ 0, 0 };
+        used--;
+        return true;
+    }
+
+    /*
+     * Remap
+     *  Moves every entry to its course's new position after courses were inserted or
+     * removed around it; the keys are unchanged, so nothing is rehashed
+     *
+     * @param const vector<uint32_t>& newPositions - new position of each old position (every indexed course must still be listed)
+     */
+    void Remap(const vector<uint32_t>& newPositions) {
+        for (Slot& slot : slots) {
+            if (slot.position != 0)
+                slot.position = newPositions[slot.position - 1] + 1;
+        }
+    }
+
+    /*
+     * Find
+     *  Looks up a course number
+     *
+     * @param const vector<Course>& courses - the vector the positions refer to
+     * @param string_view courseNumber - the course number to find
+     *
+     * @return size_t - position of the course, or SIZE_MAX if it is not indexed
+     */
+    size_t Find(const vector<Course>& courses, string_view courseNumber) const {
+        if (used == 0)
+            return SIZE_MAX;
+
+        uint32_t hash = Hash(courseNumber);
+        size_t probe = hash & mask;
+        while (slots[probe].position != 0) {
+            const Slot& slot = slots[probe];
+            if (slot.hash == hash && courses[slot.position - 1].courseNumber == courseNumber)
+                return slot.position - 1;
+            probe = (probe + 1) & mask;
+        }
+        return SIZE_MAX;
+    }
+};
+
+
+/* *****************************
+ * CourseTrie Class
+ ***************************** */
+
+// Array-based trie over the course numbers of a sorted course vector, used for autocomplete
+class CourseTrie {
+private:
+    // One trie node; the children of a node are stored next to each other, ordered by character
+    struct Node {
+        uint32_t firstChild;  // index of the first child node
+        uint32_t first;       // first course position under this node
+        uint32_t last;        // one past the last course position under this node
+        uint16_t childCount;  // number of children
+        char character;       // character on the edge into this node
+        bool isTerminal;      // true if a course number ends at this node
+    };
+
+    vector<Node> nodes; // breadth-first node array, nodes[0] is the root
+    size_t deadNodes;   // nodes left unreachable by Insert and Remove, reclaimed by the next Build
+
+    /*
+     * FindChild
+     *  Looks up the child of a node reached by a character
+     *
+     * @param const Node& node - parent node
+     * @param char character - edge character
+     *
+     * @return size_t - child node index, or SIZE_MAX if there is no such child
+     */
+    size_t FindChild(const Node& node, char character) const {
+        auto begin = nodes.begin() + node.firstChild;
+        auto end = begin + node.childCount;
+        auto child = lower_bound(begin, end, character, [](const Node& entry, char value) {
+            return static_cast<unsigned char>(entry.character) < static_cast<unsigned char>(value);
+        });
+        if (child == end || child->character != character)
+            return SIZE_MAX;
+        return static_cast<size_t>(child - nodes.begin());
+    }
+
+public:
+    /*
+     * CourseTrie
+     *  Class constructor, creates an empty trie
+     */
+    CourseTrie() : deadNodes(0) {
+    }
+
+    /*
+     * Build
+     *  Builds the trie from a collection sorted by course number
+     *
+     * Because the input is sorted, every node covers one contiguous slice of it,
+     * so a node only needs to store that slice's bounds.
+     *
+     * @param const vector<Course>& courses - courses sorted by course number
+     */
+    void Build(const vector<Course>& courses) {
+        nodes.clear();
+        nodes.push_back(Node{ 0, 0, static_cast<uint32_t>(courses.size()), 0, '\0', false });
+        vector<uint32_t> depths(1, 0); // characters from the root to each node, only needed while building
+
+        for (size_t current = 0; current < nodes.size(); current++) {
+            size_t depth = depths[current];
+            size_t position = nodes[current].first;
+            size_t last = nodes[current].last;
+
+            // Shorter course numbers sort first, so those ending here lead the slice
+            while (position < last && courses[position].courseNumber.size() == depth) {
+                nodes[current].isTerminal = true;
+                position++;
+            }
+
+            // Group the rest by their next character; each group becomes a child
+            nodes[current].firstChild = static_cast<uint32_t>(nodes.size());
+            while (position < last) {
+                char character = courses[position].courseNumber[depth];
+                size_t groupEnd = position + 1;
+                while (groupEnd < last && courses[groupEnd].courseNumber[depth] == character)
+                    groupEnd++;
+                nodes.push_back(Node{ 0, static_cast<uint32_t>(position), static_cast<uint32_t>(groupEnd), 0, character, false });
+                depths.push_back(static_cast<uint32_t>(depth + 1));
+                nodes[current].childCount++;
+                position = groupEnd;
+            }
+        }
+        nodes.shrink_to_fit();
+        deadNodes = 0;
+    }
+
+    /*
+     * Clear
+     *  Removes every node
+     */
+    void Clear() {
+        nodes.clear();
+        deadNodes = 0;
+    }
+
+    /*
+     * Insert
+     *  Adds a course number's path; call UpdateBounds once the edits are done
+     *
+     * Where the path leaves the trie, the parent's children are copied to the end of
+     * the array with the new child in order among them, so no other node moves. The
+     * rest of the number becomes a chain of single-child nodes.
+     *
+     * @param string_view courseNumber - course number to add
+     */
+    void Insert(string_view courseNumber) {
+        if (nodes.empty())
+            nodes.push_back(Node{ 0, 0, 0, 0, '\0', false });
+
+        size_t current = 0;
+        size_t depth = 0;
+        while (depth < courseNumber.size()) {
+            size_t child = FindChild(nodes[current], courseNumber[depth]);
+            if (child == SIZE_MAX)
+                break;
+            current = child;
+            depth++;
+        }
+
+        if (depth < courseNumber.size()) {
+            char character = courseNumber[depth];
+            size_t oldFirst = nodes[current].firstChild;
+            size_t count = nodes[current].childCount;
+            size_t insertAt = 0;
+            while (insertAt < count && static_cast<unsigned char>(nodes[oldFirst + insertAt].character) < static_cast<unsigned char>(character))
+                insertAt++;
+
+            size_t newFirst = nodes.size();
+            nodes.reserve(nodes.size() + count + 1 + courseNumber.size() - depth);
+            for (size_t i = 0; i <= count; i++) {
+                if (i == insertAt)
+                    nodes.push_back(Node{ 0, 0, 0, 0, character, false });
+                if (i < count)
+                    nodes.push_back(nodes[oldFirst + i]);
+            }
+            deadNodes += count;
+            nodes[current].firstChild = static_cast<uint32_t>(newFirst);
+            nodes[current].childCount = static_cast<uint16_t>(count + 1);
+            current = newFirst + insertAt;
+
+            for (depth++; depth < courseNumber.size(); depth++) {
+                nodes[current].firstChild = static_cast<uint32_t>(nodes.size());
+                nodes[current].childCount = 1;
+                nodes.push_back(Node{ 0, 0, 0, 0, courseNumber[depth], false });
+                current = nodes.size() - 1;
+            }
+        }
+        nodes[current].isTerminal = true;
+    }
+
+    /*
+     * Remove
+     *  Removes a course number, pruning the nodes that no longer lead to any course;
+     * call UpdateBounds once the edits are done
+     *
+     * @param string_view courseNumber - course number to remove
+     */
+    void Remove(string_view courseNumber) {
+        if (nodes.empty())
+            return;
+
+        vector<size_t> path(1, 0);
+        for (char character : courseNumber) {
+            size_t child = FindChild(nodes[path.back()], character);
+            if (child == SIZE_MAX)
+                return;
+            path.push_back(child);
+        }
+        nodes[path.back()].isTerminal = false;
+
+        // Close the gap in the parent's children; the last slot of the run becomes unreachable
+        while (path.size() > 1 && !nodes[path.back()].isTerminal && nodes[path.back()].childCount == 0) {
+            size_t child = path.back();
+            path.pop_back();
+            Node& parent = nodes[path.back()];
+            size_t last = parent.firstChild + parent.childCount - 1;
+            for (size_t i = child; i < last; i++)
+                nodes[i] = nodes[i + 1];
+            parent.childCount--;
+            deadNodes++;
+        }
+    }
+
+    /*
+     * UpdateBounds
+     *  Recomputes every node's slice of the collection after Insert and Remove
+     *
+     * A pre-order walk reaches course numbers in sorted order, so each node's slice
+     * starts at the number of courses passed so far. Only integers are touched.
+     *
+     * @param const vector<Course>& courses - courses sorted by course number, holding exactly the numbers in the trie
+     */
+    void UpdateBounds(const vector<Course>& courses) {
+        if (nodes.empty())
+            return;
+
+        struct Visit {
+            uint32_t node;      // node being walked
+            uint32_t depth;     // characters from the root to the node
+            uint16_t nextChild; // children already walked
+        };
+        vector<Visit> stack;
+        uint32_t position = 0;
+        stack.push_back(Visit{ 0, 0, 0 });
+        while (!stack.empty()) {
+            Visit& visit = stack.back();
+            Node& node = nodes[visit.node];
+            if (visit.nextChild == 0) {
+                node.first = position;
+                if (node.isTerminal) { // the course ending here, and any duplicates of it
+                    position++;
+                    while (position < courses.size() && courses[position].courseNumber == courses[node.first].courseNumber)
+                        position++;
+                }
+            }
+            if (visit.nextChild == node.childCount) {
+                node.last = position;
+                stack.pop_back();
+                continue;
+            }
+            uint32_t child = node.firstChild + visit.nextChild++;
+            stack.push_back(Visit{ child, visit.depth + 1, 0 });
+        }
+    }
+
+    /*
+     * IsFragmented
+     *  Checks whether edits left more unreachable nodes than live ones, so a Build is worthwhile
+     *
+     * @return bool - true if most of the node array is unreachable
+     */
+    bool IsFragmented() const {
+        return deadNodes * 2 > nodes.size();
+    }
+
+    /*
+     * Complete
+     *  Finds the courses starting with a partial course number, and extends the
+     * partial number as far as every one of those courses agrees
+     *
+     * Takes time proportional to the length of the partial number plus the length
+     * of the extension, independent of the catalog size.
+     *
+     * @param string_view partial - the characters typed so far
+     * @param string& completion - receives the partial number plus the shared continuation
+     *
+     * @return pair<size_t, size_t> - [first, last) positions of the matching courses; empty if none
+     */
+    pair<size_t, size_t> Complete(string_view partial, string& completion) const {
+        completion.assign(partial.data(), partial.size());
+        if (nodes.empty())
+            return { 0, 0 };
+
+        size_t current = 0;
+        for (char character : partial) {
+            current = FindChild(nodes[current], character);
+            if (current == SIZE_MAX)
+                return { 0, 0 };
+        }
+
+        // Follow the path while it has a single branch and no course ends on the way
+        while (!nodes[current].isTerminal && nodes[current].childCount == 1) {
+            current = nodes[current].firstChild;
+            completion.push_back(nodes[current].character);
+        }
+        return { nodes[current].first, nodes[current].last };
+    }
+
+    /*
+     * MemoryFootprint
+     *  Bytes used by the node array
+     *
+     * @return size_t - heap bytes
+     */
+    size_t MemoryFootprint() const {
+        return nodes.capacity() * sizeof(Node);
+    }
+};
+
+
+/* *****************************
+ * NameIndex Class
+ ***************************** */
+
+// Inverted index from case-folded words of course names to compressed lists of course positions
+class NameIndex {
+private:
+    string termPool;                 // every distinct word, in sorted order, back to back
+    vector<uint32_t> termOffsets;    // start of each word in termPool, plus a final end offset
+    vector<uint32_t> postingOffsets; // start of each word's posting list in postings, plus a final end offset
+    vector<uint32_t> documentCounts; // number of courses whose name contains each word
+    vector<uint8_t> postings;        // course positions per word, as varint-encoded gaps
+    vector<uint8_t> wordCounts;      // number of words in each course name (capped at 255), for ranking
+
+    // One AND group of a query: courses matching all of its words, and the group's weight
+    struct GroupResult {
+        vector<uint32_t> positions; // sorted course positions
+        double weight;              // sum of the words' inverse document frequencies
+    };
+
+    /*
+     * Term
+     *  A word of the dictionary
+     *
+     * @param size_t term - word index in sorted order
+     *
+     * @return string_view - the word
+     */
+    string_view Term(size_t term) const {
+        return string_view(termPool).substr(termOffsets[term], termOffsets[term + 1] - termOffsets[term]);
+    }
+
+    /*
+     * AppendVarint
+     *  Appends a value in 7-bit groups, low group first, with the high bit marking a continuation
+     *
+     * @param uint32_t value - value to encode
+     * @param vector<uint8_t>& output - byte buffer to append to
+     */
+    static void AppendVarint(uint32_t value, vector<uint8_t>& output) {
+        while (value >= 0x80) {
+            output.push_back(static_cast<uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        output.push_back(static_cast<uint8_t>(value));
+    }
+
+    /*
+     * DecodePostings
+     *  Appends the course positions of one word
+     *
+     * @param size_t term - word index in sorted order
+     * @param vector<uint32_t>& positions - receives the positions, in ascending order
+     */
+    void DecodePostings(size_t term, vector<uint32_t>& positions) const {
+        const uint8_t* current = postings.data() + postingOffsets[term];
+        const uint8_t* end = postings.data() + postingOffsets[term + 1];
+        uint32_t position = 0;
+        while (current < end) {
+            uint32_t gap = 0;
+            int shift = 0;
+            while (*current & 0x80) {
+                gap |= static_cast<uint32_t>(*current++ & 0x7F) << shift;
+                shift += 7;
+            }
+            gap |= static_cast<uint32_t>(*current++) << shift;
+            position += gap;
+            positions.push_back(position);
+        }
+    }
+
+    /*
+     * MatchWord
+     *  Finds the courses containing a word, or any word starting with it
+     *
+     * @param string_view word - case-folded word
+     * @param bool isPrefix - true to match every word that starts with word
+     * @param vector<uint32_t>& positions - receives the sorted, distinct course positions
+     */
+    void MatchWord(string_view word, bool isPrefix, vector<uint32_t>& positions) const {
+        positions.clear();
+        size_t termCount = documentCounts.size();
+        size_t first = 0;
+        size_t count = termCount;
+        while (count > 0) { // lower bound over the sorted dictionary
+            size_t step = count / 2;
+            if (Term(first + step) < word) {
+                first += step + 1;
+                count -= step + 1;
+            }
+            else {
+                count = step;
+            }
+        }
+
+        size_t last = first;
+        size_t total = 0;
+        while (last < termCount && (isPrefix ? Term(last).substr(0, word.size()) == word : Term(last) == word))
+            total += documentCounts[last++];
+        positions.reserve(total);
+        for (size_t term = first; term < last; term++)
+            DecodePostings(term, positions);
+        if (last - first > 1) { // several words' lists were appended one after another
+            sort(positions.begin(), positions.end());
+            positions.erase(unique(positions.begin(), positions.end()), positions.end());
+        }
+    }
+
+public:
+    /*
+     * NextWord
+     *  Reads the next word of a text: a run of letters and digits, case-folded to lower case
+     *
+     * @param string_view text - text to read from
+     * @param size_t offset - where to start reading
+     * @param string& word - receives the word; empty if the text has no more words
+     *
+     * @return size_t - offset just after the word
+     */
+    static size_t NextWord(string_view text, size_t offset, string& word) {
+        word.clear();
+        while (offset < text.size() && !isalnum(static_cast<unsigned char>(text[offset])))
+            offset++;
+        while (offset < text.size() && isalnum(static_cast<unsigned char>(text[offset])))
+            word.push_back(static_cast<char>(tolower(static_cast<unsigned char>(text[offset++]))));
+        return offset;
+    }
+
+    /*
+     * Build
+     *  Indexes the names of a course collection
+     *
+     * Words are collected with a hash map in one pass over the names, then the
+     * positions are grouped per word with a counting sort, so each posting list comes
+     * out already in ascending order and is stored as varint-encoded gaps.
+     *
+     * @param const vector<Course>& courses - courses to index; postings refer to their positions
+     */
+    void Build(const vector<Course>& courses) {
+        Clear();
+        unordered_map<string, uint32_t> wordIds;
+        vector<string> words;                          // distinct words, by first appearance
+        vector<pair<uint32_t, uint32_t>> occurrences;  // (word id, course position), in position order
+        occurrences.reserve(courses.size() * 3);
+        wordCounts.resize(courses.size());
+
+        string word;
+        vector<uint32_t> courseWords;
+        for (size_t position = 0; position < courses.size(); position++) {
+            string_view name = courses[position].name;
+            courseWords.clear();
+            size_t offset = NextWord(name, 0, word);
+            while (!word.empty()) {
+                auto found = wordIds.find(word);
+                if (found == wordIds.end()) {
+                    found = wordIds.emplace(word, static_cast<uint32_t>(words.size())).first;
+                    words.push_back(word);
+                }
+                if (find(courseWords.begin(), courseWords.end(), found->second) == courseWords.end()) {
+                    courseWords.push_back(found->second);
+                    occurrences.emplace_back(found->second, static_cast<uint32_t>(position));
+                }
+                offset = NextWord(name, offset, word);
+            }
+            wordCounts[position] = static_cast<uint8_t>(min<size_t>(max<size_t>(courseWords.size(), 1), 255));
+        }
+
+        // Dictionary in sorted order, so prefix terms cover one run of entries
+        vector<uint32_t> sortedIds(words.size());
+        for (size_t i = 0; i < sortedIds.size(); i++)
+            sortedIds[i] = static_cast<uint32_t>(i);
+        sort(sortedIds.begin(), sortedIds.end(), [&words](uint32_t a, uint32_t b) { return words[a] < words[b]; });
+        vector<uint32_t> rankOf(words.size());
+        termOffsets.reserve(words.size() + 1);
+        for (size_t rank = 0; rank < sortedIds.size(); rank++) {
+            rankOf[sortedIds[rank]] = static_cast<uint32_t>(rank);
+            termOffsets.push_back(static_cast<uint32_t>(termPool.size()));
+            termPool.append(words[sortedIds[rank]]);
+        }
+        termOffsets.push_back(static_cast<uint32_t>(termPool.size()));
+
+        // Counting sort of the occurrences by word rank; positions stay ascending within a word
+        documentCounts.assign(words.size(), 0);
+        for (const pair<uint32_t, uint32_t>& occurrence : occurrences)
+            documentCounts[rankOf[occurrence.first]]++;
+        vector<size_t> slot(words.size() + 1, 0);
+        for (size_t rank = 0; rank < words.size(); rank++)
+            slot[rank + 1] = slot[rank] + documentCounts[rank];
+        vector<uint32_t> grouped(occurrences.size());
+        for (const pair<uint32_t, uint32_t>& occurrence : occurrences)
+            grouped[slot[rankOf[occurrence.first]]++] = occurrence.second;
+
+        postings.reserve(grouped.size() * 2);
+        postingOffsets.reserve(words.size() + 1);
+        size_t next = 0;
+        for (size_t rank = 0; rank < words.size(); rank++) {
+            postingOffsets.push_back(static_cast<uint32_t>(postings.size()));
+            uint32_t previous = 0;
+            for (uint32_t i = 0; i < documentCounts[rank]; i++) {
+                uint32_t position = grouped[next++];
+                AppendVarint(position - previous, postings);
+                previous = position;
+            }
+        }
+        postingOffsets.push_back(static_cast<uint32_t>(postings.size()));
+        postings.shrink_to_fit();
+    }
+
+    /*
+     * Patch
+     *  Updates the index after courses were inserted, removed or renamed, without re-reading every name
+     *
+     * Only the new names are split into words. Every posting list is decoded, its
+     * positions moved to where their courses now sit, merged with the new names'
+     * positions and re-encoded, which is integer work only. Words no longer used by
+     * any course are dropped, and new words are merged into the sorted dictionary.
+     *
+     * @param const vector<uint32_t>& newPositions - new position of each old position, or UINT32_MAX if the course
+     *                                               was removed or renamed
+     * @param const vector<Course>& courses - the updated collection
+     * @param const vector<uint32_t>& named - ascending positions in courses whose names are not indexed yet
+     */
+    void Patch(const vector<uint32_t>& newPositions, const vector<Course>& courses, const vector<uint32_t>& named) {
+        vector<uint8_t> newWordCounts(courses.size(), 1);
+        for (size_t position = 0; position < newPositions.size() && position < wordCounts.size(); position++) {
+            if (newPositions[position] != UINT32_MAX)
+                newWordCounts[newPositions[position]] = wordCounts[position];
+        }
+
+        // (word, position) pairs of the new names, sorted to merge with the dictionary
+        vector<pair<string, uint32_t>> added;
+        string word;
+        vector<string> courseWords;
+        for (uint32_t position : named) {
+            courseWords.clear();
+            size_t offset = NextWord(courses[position].name, 0, word);
+            while (!word.empty()) {
+                if (find(courseWords.begin(), courseWords.end(), word) == courseWords.end()) {
+                    courseWords.push_back(word);
+                    added.emplace_back(word, position);
+                }
+                offset = NextWord(courses[position].name, offset, word);
+            }
+            newWordCounts[position] = static_cast<uint8_t>(min<size_t>(max<size_t>(courseWords.size(), 1), 255));
+        }
+        sort(added.begin(), added.end());
+
+        string newTermPool;
+        vector<uint32_t> newTermOffsets;
+        vector<uint32_t> newPostingOffsets;
+        vector<uint32_t> newDocumentCounts;
+        vector<uint8_t> newPostings;
+        newTermPool.reserve(termPool.size());
+        newPostings.reserve(postings.size() + added.size() * 2);
+
+        size_t termCount = documentCounts.size();
+        size_t term = 0;
+        size_t next = 0;
+        vector<uint32_t> positions;
+        while (term < termCount || next < added.size()) {
+            positions.clear();
+            bool isExisting = term < termCount && (next == added.size() || Term(term) <= added[next].first);
+            string_view current = isExisting ? Term(term) : string_view(added[next].first);
+            if (isExisting) {
+                // Positions move monotonically, so the kept ones stay in ascending order
+                DecodePostings(term++, positions);
+                size_t kept = 0;
+                for (uint32_t position : positions) {
+                    if (newPositions[position] != UINT32_MAX)
+                        positions[kept++] = newPositions[position];
+                }
+                positions.resize(kept);
+            }
+            size_t middle = positions.size();
+            while (next < added.size() && added[next].first == current)
+                positions.push_back(added[next++].second);
+            inplace_merge(positions.begin(), positions.begin() + middle, positions.end());
+            if (positions.empty())
+                continue;
+
+            newTermOffsets.push_back(static_cast<uint32_t>(newTermPool.size()));
+            newTermPool.append(current);
+            newPostingOffsets.push_back(static_cast<uint32_t>(newPostings.size()));
+            newDocumentCounts.push_back(static_cast<uint32_t>(positions.size()));
+            uint32_t previous = 0;
+            for (uint32_t position : positions) {
+                AppendVarint(position - previous, newPostings);
+                previous = position;
+            }
+        }
+        newTermOffsets.push_back(static_cast<uint32_t>(newTermPool.size()));
+        newPostingOffsets.push_back(static_cast<uint32_t>(newPostings.size()));
+
+        termPool.swap(newTermPool);
+        termOffsets.swap(newTermOffsets);
+        postingOffsets.swap(newPostingOffsets);
+        documentCounts.swap(newDocumentCounts);
+        postings.swap(newPostings);
+        wordCounts.swap(newWordCounts);
+    }
+
+    /*
+     * Clear
+     *  Removes every word and posting
+     */
+    void Clear() {
+        termPool.clear();
+        termOffsets.clear();
+        postingOffsets.clear();
+        documentCounts.clear();
+        postings.clear();
+        wordCounts.clear();
+    }
+
+    /*
+     * Query
+     *  Finds and ranks the courses whose names match a keyword query
+     *
+     * Words are combined with AND; "OR" (or "|") separates alternatives, so
+     * "data structures OR algorithms" matches either. A trailing '*' makes a word
+     * a prefix ("program*"). Courses score the inverse document frequency of the
+     * words they match, divided by the square root of their name's word count,
+     * so rare words and short, specific names rank first.
+     *
+     * @param string_view query - keyword query
+     * @param size_t limit - maximum number of ranked positions to return
+     * @param vector<uint32_t>& ranked - receives the best matches, best first
+     *
+     * @return size_t - total number of matching courses
+     */
+    size_t Query(string_view query, size_t limit, vector<uint32_t>& ranked) const {
+        ranked.clear();
+        if (wordCounts.empty())
+            return 0;
+
+        // Split into OR groups of AND words
+        vector<GroupResult> groups(1);
+        vector<pair<string, bool>> groupWords;
+        vector<vector<uint32_t>> matches;
+        vector<uint32_t> intersection;
+        auto evaluateGroup = [&]() {
+            GroupResult& group = groups.back();
+            group.weight = 0.0;
+            matches.resize(groupWords.size());
+            for (size_t i = 0; i < groupWords.size(); i++) {
+                MatchWord(groupWords[i].first, groupWords[i].second, matches[i]);
+                group.weight += log(1.0 + static_cast<double>(wordCounts.size()) / max<size_t>(matches[i].size(), 1));
+            }
+
+            // Intersect starting from the shortest list, so every step is as small as possible
+            sort(matches.begin(), matches.end(), [](const vector<uint32_t>& a, const vector<uint32_t>& b) { return a.size() < b.size(); });
+            group.positions.swap(matches[0]);
+            for (size_t i = 1; i < matches.size() && !group.positions.empty(); i++) {
+                intersection.clear();
+                set_intersection(group.positions.begin(), group.positions.end(), matches[i].begin(), matches[i].end(), back_inserter(intersection));
+                group.positions.swap(intersection);
+            }
+            groupWords.clear();
+        };
+
+        size_t offset = 0;
+        while (offset < query.size()) {
+            while (offset < query.size() && isspace(static_cast<unsigned char>(query[offset])))
+                offset++;
+            size_t end = offset;
+            while (end < query.size() && !isspace(static_cast<unsigned char>(query[end])))
+                end++;
+            string_view item = query.substr(offset, end - offset);
+            offset = end;
+            if (item.empty())
+                break;
+            if (item == "OR" || item == "|") {
+                if (!groupWords.empty()) {
+                    evaluateGroup();
+                    groups.emplace_back();
+                }
+                continue;
+            }
+
+            bool isPrefix = (item.back() == '*');
+            string word;
+            size_t wordOffset = NextWord(item, 0, word);
+            while (!word.empty()) {
+                string following;
+                wordOffset = NextWord(item, wordOffset, following);
+                groupWords.emplace_back(word, isPrefix && following.empty()); // only the last word of "data-struct*" is a prefix
+                word.swap(following);
+            }
+        }
+        if (!groupWords.empty())
+            evaluateGroup();
+
+        // One group: every match has the same weight, so the ranking is by name word count
+        // alone and the best can be picked with a histogram instead of scoring every match
+        if (groups.size() == 1) {
+            const vector<uint32_t>& positions = groups[0].positions;
+            size_t histogram[256] = {};
+            for (uint32_t position : positions)
+                histogram[wordCounts[position]]++;
+            size_t cutoff = 0;    // word count of the last courses that still fit within limit
+            size_t belowCutoff = 0;
+            while (cutoff < 255 && belowCutoff + histogram[cutoff] < limit)
+                belowCutoff += histogram[cutoff++];
+            size_t cutoffSlots = limit - min(limit, belowCutoff);
+
+            vector<pair<uint8_t, uint32_t>> best;
+            for (uint32_t position : positions) {
+                uint8_t words = wordCounts[position];
+                if (words < cutoff || (words == cutoff && cutoffSlots > 0 && cutoffSlots--))
+                    best.emplace_back(words, position);
+            }
+            sort(best.begin(), best.end());
+            for (const pair<uint8_t, uint32_t>& entry : best)
+                ranked.push_back(entry.second);
+            return positions.size();
+        }
+
+        // Merge the groups; a course matching several alternatives adds up their weights
+        vector<pair<double, uint32_t>> scored;
+        for (const GroupResult& group : groups) {
+            // Both lists are in position order, so one merge pass combines them
+            vector<pair<double, uint32_t>> merged;
+            merged.reserve(scored.size() + group.positions.size());
+            size_t i = 0;
+            size_t j = 0;
+            while (i < scored.size() || j < group.positions.size()) {
+                if (j == group.positions.size() || (i < scored.size() && scored[i].second < group.positions[j]))
+                    merged.push_back(scored[i++]);
+                else if (i == scored.size() || group.positions[j] < scored[i].second)
+                    merged.emplace_back(group.weight, group.positions[j++]);
+                else
+                    merged.emplace_back(scored[i++].first + group.weight, group.positions[j++]);
+            }
+            scored.swap(merged);
+        }
+        for (pair<double, uint32_t>& entry : scored)
+            entry.first /= sqrt(static_cast<double>(wordCounts[entry.second]));
+
+        // Keep only the best, highest score first, then catalog order
+        auto better = [](const pair<double, uint32_t>& a, const pair<double, uint32_t>& b) {
+            return (a.first != b.first) ? a.first > b.first : a.second < b.second;
+        };
+        size_t keep = min(limit, scored.size());
+        if (keep < scored.size())
+            nth_element(scored.begin(), scored.begin() + keep, scored.end(), better);
+        sort(scored.begin(), scored.begin() + keep, better);
+        for (size_t i = 0; i < keep; i++)
+            ranked.push_back(scored[i].second);
+        return scored.size();
+    }
+
+    /*
+     * MemoryFootprint
+     *  Bytes used by the dictionary and posting lists
+     *
+     * @return size_t - heap bytes
+     */
+    size_t MemoryFootprint() const {
+        return termPool.capacity() + postings.capacity() + wordCounts.capacity()
+            + (termOffsets.capacity() + postingOffsets.capacity() + documentCounts.capacity()) * sizeof(uint32_t);
+    }
+};
+
+
+/* *****************************
+ * PrerequisiteGraph Class
+ ***************************** */
+
+// Prerequisite edges between collection positions, in compressed sparse row (CSR) form
+class PrerequisiteGraph {
+public:
+    // Read-only view of one row of edges
+    struct EdgeList {
+        const uint32_t* first; // first edge in the row
+        const uint32_t* last;  // one past the last edge in the row
+
+        const uint32_t* begin() const { return first; }
+        const uint32_t* end() const { return last; }
+        size_t size() const { return static_cast<size_t>(last - first); }
+        bool empty() const { return first == last; }
+    };
+
+    // A prerequisite that names a course number not found in the collection
+    struct UnresolvedPrerequisite {
+        uint32_t course;          // position of the course that lists the prerequisite
+        string_view prerequisite; // the course number that could not be found (a view of the course's text)
+    };
+
+private:
+    vector<uint32_t> forwardStart; // course i's prerequisites are forwardEdges[forwardStart[i], forwardStart[i + 1])
+    vector<uint32_t> forwardEdges; // positions of prerequisites, in listed order
+    vector<uint32_t> reverseStart; // course i's dependents are reverseEdges[reverseStart[i], reverseStart[i + 1])
+    vector<uint32_t> reverseEdges; // positions of courses that list course i as a prerequisite
+    vector<UnresolvedPrerequisite> unresolved; // side table of missing prerequisites, ordered by course
+
+    /*
+     * ResolveRows
+     *  Resolves the prerequisites of courses [first, last), appending one row per course
+     *
+     * @param const vector<Course>& courses - the course collection
+     * @param const CourseHashIndex& index - hash index over the same collection
+     * @param size_t first - first course to resolve
+     * @param size_t last - one past the last course to resolve
+     * @param vector<uint32_t>& rowEnds - receives edges.size() after each course's row
+     * @param vector<uint32_t>& edges - receives the resolved prerequisite positions
+     * @param vector<UnresolvedPrerequisite>& missing - receives prerequisites that are not in the collection
+     */
+    static void ResolveRows(const vector<Course>& courses, const CourseHashIndex& index, size_t first, size_t last,
+                            vector<uint32_t>& rowEnds, vector<uint32_t>& edges, vector<UnresolvedPrerequisite>& missing) {
+        for (size_t i = first; i < last; i++) {
+            for (string_view prerequisite : courses[i].prerequisites) {
+                size_t position = index.Find(courses, prerequisite);
+                if (position == SIZE_MAX)
+                    missing.push_back(UnresolvedPrerequisite{ static_cast<uint32_t>(i), prerequisite });
+                else
+                    edges.push_back(static_cast<uint32_t>(position));
+            }
+            rowEnds.push_back(static_cast<uint32_t>(edges.size()));
+        }
+    }
+
+    /*
+     * BuildReverseRows
+     *  Fills the dependent rows from the forward rows by counting dependents per course and scattering
+     */
+    void BuildReverseRows() {
+        size_t courseCount = CourseCount();
+        reverseStart.assign(courseCount + 1, 0);
+        for (uint32_t prerequisite : forwardEdges)
+            reverseStart[prerequisite + 1]++;
+        for (size_t i = 0; i < courseCount; i++)
+            reverseStart[i + 1] += reverseStart[i];
+
+        reverseEdges.assign(forwardEdges.size(), 0);
+        vector<uint32_t> fillPosition(reverseStart.begin(), reverseStart.end() - 1);
+        for (size_t i = 0; i < courseCount; i++) {
+            for (uint32_t e = forwardStart[i]; e < forwardStart[i + 1]; e++)
+                reverseEdges[fillPosition[forwardEdges[e]]++] = static_cast<uint32_t>(i);
+        }
+    }
+
+public:
+    /*
+     * Build
+     *  Resolves every listed prerequisite to a collection position, once
+     *
+     * Forward rows are filled in a single pass over the courses; with several threads,
+     * blocks of rows are resolved in parallel and then joined in order. Reverse rows
+     * are then filled by counting dependents per course and scattering (a counting
+     * sort), so neither direction needs per-course allocations.
+     *
+     * @param const vector<Course>& courses - the course collection
+     * @param const CourseHashIndex& index - hash index over the same collection
+     * @param unsigned threadCount = 1 - threads resolving forward rows (0 uses all cores)
+     */
+    void Build(const vector<Course>& courses, const CourseHashIndex& index, unsigned threadCount = 1) {
+        const size_t BLOCK_ROWS = 16384; // rows resolved by one parallel task
+        size_t courseCount = courses.size();
+        forwardStart.assign(1, 0);
+        forwardStart.reserve(courseCount + 1);
+        forwardEdges.clear();
+        unresolved.clear();
+
+        size_t blockCount = (courseCount + BLOCK_ROWS - 1) / BLOCK_ROWS;
+        if (Utils::ResolveThreadCount(threadCount) <= 1 || blockCount <= 1) {
+            ResolveRows(courses, index, 0, courseCount, forwardStart, forwardEdges, unresolved);
+        }
+        else {
+            vector<vector<uint32_t>> blockStarts(blockCount);
+            vector<vector<uint32_t>> blockEdges(blockCount);
+            vector<vector<UnresolvedPrerequisite>> blockUnresolved(blockCount);
+            Utils::RunParallel(blockCount, threadCount, [&](size_t block) {
+                size_t first = block * BLOCK_ROWS;
+                ResolveRows(courses, index, first, min(courseCount, first + BLOCK_ROWS),
+                            blockStarts[block], blockEdges[block], blockUnresolved[block]);
+            });
+            for (size_t block = 0; block < blockCount; block++) {
+                uint32_t offset = static_cast<uint32_t>(forwardEdges.size());
+                for (uint32_t rowEnd : blockStarts[block])
+                    forwardStart.push_back(offset + rowEnd);
+                forwardEdges.insert(forwardEdges.end(), blockEdges[block].begin(), blockEdges[block].end());
+                move(blockUnresolved[block].begin(), blockUnresolved[block].end(), back_inserter(unresolved));
+            }
+        }
+
+        BuildReverseRows();
+    }
+
+    /*
+     * Patch
+     *  Updates the graph after a reload, resolving only the rows that may have changed
+     *
+     * Rows of unchanged courses are copied with their edges moved to the new positions.
+     * A row is resolved again through the hash index only if its course is new or
+     * changed, it listed a course that was removed, or one of its missing prerequisites
+     * is now in the collection. The dependents are then refilled from the forward rows.
+     * The missing-prerequisite views of copied rows are kept, so the text of unchanged
+     * courses must not have moved.
+     *
+     * @param const vector<Course>& courses - the updated collection
+     * @param const CourseHashIndex& index - hash index over the updated collection
+     * @param const vector<uint32_t>& newPositions - new position of each old position, or UINT32_MAX if the course was removed
+     * @param const vector<uint32_t>& sources - old position of each unchanged course in courses, or UINT32_MAX for a new or changed one
+     * @param bool hasNewCourses - true if courses were inserted, so missing prerequisites may now resolve
+     */
+    void Patch(const vector<Course>& courses, const CourseHashIndex& index, const vector<uint32_t>& newPositions,
+               const vector<uint32_t>& sources, bool hasNewCourses) {
+        size_t courseCount = courses.size();
+        vector<uint32_t> start(1, 0);
+        vector<uint32_t> edges;
+        vector<UnresolvedPrerequisite> missing;
+        start.reserve(courseCount + 1);
+        edges.reserve(forwardEdges.size());
+
+        // Unchanged courses keep their order, so the old side table is walked once alongside them
+        size_t nextUnresolved = 0;
+        for (size_t i = 0; i < courseCount; i++) {
+            uint32_t source = sources[i];
+            bool isCopied = (source != UINT32_MAX);
+            if (isCopied) {
+                while (nextUnresolved < unresolved.size() && unresolved[nextUnresolved].course < source)
+                    nextUnresolved++;
+                size_t lastUnresolved = nextUnresolved;
+                while (lastUnresolved < unresolved.size() && unresolved[lastUnresolved].course == source)
+                    lastUnresolved++;
+
+                for (uint32_t e = forwardStart[source]; e < forwardStart[source + 1] && isCopied; e++)
+                    isCopied = (newPositions[forwardEdges[e]] != UINT32_MAX);
+                for (size_t u = nextUnresolved; u < lastUnresolved && isCopied && hasNewCourses; u++)
+                    isCopied = (index.Find(courses, unresolved[u].prerequisite) == SIZE_MAX);
+
+                if (isCopied) {
+                    for (uint32_t e = forwardStart[source]; e < forwardStart[source + 1]; e++)
+                        edges.push_back(newPositions[forwardEdges[e]]);
+                    for (size_t u = nextUnresolved; u < lastUnresolved; u++)
+                        missing.push_back(UnresolvedPrerequisite{ static_cast<uint32_t>(i), unresolved[u].prerequisite });
+                    start.push_back(static_cast<uint32_t>(edges.size()));
+                }
+                nextUnresolved = lastUnresolved;
+            }
+            if (!isCopied)
+                ResolveRows(courses, index, i, i + 1, start, edges, missing);
+        }
+
+        forwardStart.swap(start);
+        forwardEdges.swap(edges);
+        unresolved.swap(missing);
+        BuildReverseRows();
+    }
+
+    /*
+     * CourseCount
+     *  Number of courses (rows) in the graph
+     *
+     * @return size_t - course count
+     */
+    size_t CourseCount() const {
+        return forwardStart.empty() ? 0 : forwardStart.size() - 1;
+    }
+
+    /*
+     * EdgeCount
+     *  Number of resolved prerequisite edges
+     *
+     * @return size_t - edge count
+     */
+    size_t EdgeCount() const {
+        return forwardEdges.size();
+    }
+
+    /*
+     * Prerequisites
+     *  Resolved prerequisites of a course
+     *
+     * @param size_t course - position of the course
+     *
+     * @return EdgeList - positions of its prerequisites
+     */
+    EdgeList Prerequisites(size_t course) const {
+        return EdgeList{ forwardEdges.data() + forwardStart[course], forwardEdges.data() + forwardStart[course + 1] };
+    }
+
+    /*
+     * Dependents
+     *  Courses that list a course as a prerequisite
+     *
+     * @param size_t course - position of the course
+     *
+     * @return EdgeList - positions of the courses that require it
+     */
+    EdgeList Dependents(size_t course) const {
+        return EdgeList{ reverseEdges.data() + reverseStart[course], reverseEdges.data() + reverseStart[course + 1] };
+    }
+
+    /*
+     * GetUnresolved
+     *  Every prerequisite that could not be resolved, ordered by course position
+     *
+     * @return const vector<UnresolvedPrerequisite>& - the side table
+     */
+    const vector<UnresolvedPrerequisite>& GetUnresolved() const {
+        return unresolved;
+    }
+
+    /*
+     * UnresolvedFor
+     *  Range of side table entries for one course
+     *
+     * @param size_t course - position of the course
+     *
+     * @return pair<size_t, size_t> - [first, last) positions in GetUnresolved()
+     */
+    pair<size_t, size_t> UnresolvedFor(size_t course) const {
+        auto byCourse = [](const UnresolvedPrerequisite& entry, uint32_t value) { return entry.course < value; };
+        size_t first = lower_bound(unresolved.begin(), unresolved.end(), static_cast<uint32_t>(course), byCourse) - unresolved.begin();
+        size_t last = lower_bound(unresolved.begin(), unresolved.end(), static_cast<uint32_t>(course + 1), byCourse) - unresolved.begin();
+        return make_pair(first, last);
+    }
+};
+
+
+/* *****************************
+ * PrerequisiteAnalysis Class
+ ***************************** */
+
+// Whole-catalog prerequisite analysis: topological order, levels, cycles and transitive prerequisites
+class PrerequisiteAnalysis {
+private:
+    static const uint32_t NO_LEVEL = UINT32_MAX; // level of a course that is in, or depends on, a cycle
+
+    size_t courseCount;              // number of courses analyzed
+    vector<uint32_t> order;          // acyclic courses in a valid taking order (Kahn's algorithm)
+    vector<uint32_t> levels;         // longest prerequisite chain below each course, or NO_LEVEL
+    vector<vector<uint32_t>> cycles; // each entry lists the courses of one prerequisite cycle, in edge order
+
+    /*
+     * FindCycles
+     *  Depth-first search over the courses Kahn's algorithm could not order,
+     * recording one cycle for every back edge found
+     *
+     * @param const PrerequisiteGraph& graph - the graph being analyzed
+     */
+    void FindCycles(const PrerequisiteGraph& graph) {
+        // 0 = not visited, 1 = on the current search path, 2 = finished
+        vector<uint8_t> state(courseCount, 0);
+        vector<pair<uint32_t, size_t>> path; // course and the next prerequisite to follow
+
+        for (size_t start = 0; start < courseCount; start++) {
+            if (levels[start] != NO_LEVEL || state[start] != 0)
+                continue;
+
+            path.emplace_back(static_cast<uint32_t>(start), 0);
+            state[start] = 1;
+            while (!path.empty()) {
+                uint32_t course = path.back().first;
+                PrerequisiteGraph::EdgeList prerequisites = graph.Prerequisites(course);
+                if (path.back().second == prerequisites.size()) {
+                    state[course] = 2;
+                    path.pop_back();
+                    continue;
+                }
+
+                uint32_t next = prerequisites.first[path.back().second++];
+                if (levels[next] != NO_LEVEL || state[next] == 2)
+                    continue;
+                if (state[next] == 1) {
+                    // Back edge, the cycle is the path from next up to the current course
+                    vector<uint32_t> cycle;
+                    size_t i = path.size();
+                    while (path[i - 1].first != next)
+                        i--;
+                    for (; i <= path.size(); i++)
+                        cycle.push_back(path[i - 1].first);
+                    cycles.push_back(cycle);
+                    continue;
+                }
+                state[next] = 1;
+                path.emplace_back(next, 0);
+            }
+        }
+    }
+
+    /*
+     * WalkPrerequisites
+     *  Breadth-first search from a course through its prerequisites, reporting each course reached once
+     *
+     * Visited courses are marked in a scratch bitset of one bit per course, so a walk
+     * allocates courses / 8 bytes however many courses it reaches.
+     *
+     * @param const PrerequisiteGraph& graph - the graph passed to Analyze()
+     * @param size_t course - position of the starting course, which is not reported
+     * @param const function<bool(uint32_t)>& visit - called with each course reached; returning false ends the walk
+     */
+    void WalkPrerequisites(const PrerequisiteGraph& graph, size_t course, const function<bool(uint32_t)>& visit) const {
+        vector<uint64_t> isReached((courseCount + 63) / 64, 0);
+        vector<uint32_t> queue(1, static_cast<uint32_t>(course));
+        isReached[course / 64] |= uint64_t(1) << (course % 64);
+        for (size_t next = 0; next < queue.size(); next++) {
+            for (uint32_t prerequisite : graph.Prerequisites(queue[next])) {
+                uint64_t bit = uint64_t(1) << (prerequisite % 64);
+                if (isReached[prerequisite / 64] & bit)
+                    continue;
+                isReached[prerequisite / 64] |= bit;
+                queue.push_back(prerequisite);
+                if (!visit(prerequisite))
+                    return;
+            }
+        }
+    }
+
+public:
+    /*
+     * PrerequisiteAnalysis
+     *  Class constructor, creates an empty analysis
+     */
+    PrerequisiteAnalysis() : courseCount(0) {
+    }
+
+    /*
+     * Analyze
+     *  Orders the catalog, assigns levels and finds cycles
+     *
+     * Kahn's algorithm repeatedly takes a course whose prerequisites have all been
+     * taken. A course's level is one more than the highest level among its prerequisites,
+     * so level 0 courses have none. Courses left over when Kahn's algorithm stops are
+     * in a cycle, or depend on one, and get no level.
+     *
+     * @param const PrerequisiteGraph& graph - resolved prerequisite graph to analyze
+     */
+    void Analyze(const PrerequisiteGraph& graph) {
+        courseCount = graph.CourseCount();
+        order.clear();
+        order.reserve(courseCount);
+        levels.assign(courseCount, 0);
+        cycles.clear();
+
+        vector<uint32_t> remaining(courseCount);
+        for (size_t i = 0; i < courseCount; i++) {
+            remaining[i] = static_cast<uint32_t>(graph.Prerequisites(i).size());
+            if (remaining[i] == 0)
+                order.push_back(static_cast<uint32_t>(i));
+        }
+
+        // The order vector doubles as the queue of courses ready to take
+        for (size_t next = 0; next < order.size(); next++) {
+            uint32_t course = order[next];
+            for (uint32_t dependent : graph.Dependents(course)) {
+                levels[dependent] = max(levels[dependent], levels[course] + 1);
+                if (--remaining[dependent] == 0)
+                    order.push_back(dependent);
+            }
+        }
+
+        if (order.size() < courseCount) {
+            for (size_t i = 0; i < courseCount; i++) {
+                if (remaining[i] != 0)
+                    levels[i] = NO_LEVEL;
+            }
+            FindCycles(graph);
+        }
+    }
+
+    /*
+     * AllPrerequisites
+     *  Every direct and transitive prerequisite of a course, in position order
+     *
+     * Walks the graph from the course, which costs only the edges it can reach.
+     *
+     * @param const PrerequisiteGraph& graph - the graph passed to Analyze()
+     * @param size_t course - position of the course
+     *
+     * @return vector<uint32_t> - positions of all required courses (none for a course in or behind a cycle)
+     */
+    vector<uint32_t> AllPrerequisites(const PrerequisiteGraph& graph, size_t course) const {
+        vector<uint32_t> result;
+        if (levels[course] == NO_LEVEL)
+            return result;
+        WalkPrerequisites(graph, course, [&result](uint32_t reached) {
+            result.push_back(reached);
+            return true;
+        });
+        sort(result.begin(), result.end());
+        return result;
+    }
+
+    /*
+     * GetOrder
+     *  Courses in a valid taking order, excluding courses in or behind a cycle
+     *
+     * @return const vector<uint32_t>& - course positions
+     */
+    const vector<uint32_t>& GetOrder() const {
+        return order;
+    }
+
+    /*
+     * GetLevel
+     *  Level of a course (0 for courses without prerequisites)
+     *
+     * @param size_t course - position of the course
+     *
+     * @return long - level, or -1 if the course is in or depends on a cycle
+     */
+    long GetLevel(size_t course) const {
+        return (levels[course] == NO_LEVEL) ? -1 : static_cast<long>(levels[course]);
+    }
+
+    /*
+     * GetCycles
+     *  Prerequisite cycles found by Analyze()
+     *
+     * @return const vector<vector<uint32_t>>& - one list of course positions per cycle
+     */
+    const vector<vector<uint32_t>>& GetCycles() const {
+        return cycles;
+    }
+
+    /*
+     * IsAcyclic
+     *  Indicates whether every course could be ordered
+     *
+     * @return bool - true if the catalog has no prerequisite cycles
+     */
+    bool IsAcyclic() const {
+        return order.size() == courseCount;
+    }
+};
+
+
+/* *****************************
+ * Vector Class
+ ***************************** */
+
+// Vector class for storing courses
+class Vector {
+/* *****************************
+* Vector Class - Private section
+***************************** */
+private:
+    // Private varables
+    inline static SortMode sortMode = SortMode::Radix; // sorting algorithm used by SortVector, shared by all instances
+    vector<Course> courseCollection; // Class variable: collection of courses
+    StringArena courseText;          // text of every course in courseCollection
+    size_t deadTextBytes;            // bytes of courseText no longer used by any course, after reloads
+    bool isSorted;                   // flag to show if the courseCollection is sorted
+    CourseHashIndex courseIndex;     // course number to position in courseCollection
+    CourseTrie courseTrie;           // course number prefixes over courseCollection, only current while isSorted
+    NameIndex nameIndex;             // words of course names to positions in courseCollection, only current while isSorted
+    PrerequisiteGraph prerequisiteGraph; // resolved prerequisite edges between courseCollection positions
+    bool isGraphCurrent;             // flag to show if prerequisiteGraph matches courseCollection
+
+    /*
+     * Partition
+     *  Partition function for quicksort. Handles the actual swap sorting process.
+     *
+     * @param vector<Course>& coursesVector - the vector of courses to be sorted
+     * @param size_t begin - the starting index to sort from
+     * @param size_t end - the end index to sort to
+     *
+     * @return int - returns the high value, to be used as the middle dividing value in subsequent calls
+     */
+    static int Partition(vector<Course>& coursesVector, size_t begin, size_t end) {
+        int low = static_cast<int>(begin);
+        int high = static_cast<int>(end);
+        int middlePoint = static_cast<int>(begin + ((end - begin) / 2));
+
+        string_view pivot = coursesVector[middlePoint].courseNumber; // views the arena, so swaps do not change it
+
+        while (true) {
+            while (coursesVector[low].courseNumber < pivot)
+                low++;
+            while (pivot < coursesVector[high].courseNumber)
+                high--;
+
+            if (low >= high)
+                return high;
+            else {
+                swap(coursesVector[low], coursesVector[high]);
+                low++;
+                high--;
+            }
+        }
+
+        return high;
+    }
+
+    /*
+     * Quicksort
+     *  Recursive sort function for sorting a vector of courses
+     *
+     * @param vector<Course>& coursesVector - the vector of courses to be sorted
+     * @param size_t begin - the starting index to sort from
+     * @param size_t end - the end index to sort to
+     */
+    static void Quicksort(vector<Course>& coursesVector, size_t begin, size_t end) {
+        if (begin >= end)
+            return;
+
+        size_t mid = Partition(coursesVector, begin, end);
+        Quicksort(coursesVector, begin, mid);
+        Quicksort(coursesVector, mid + 1, end);
+    }
+
+    /*
+     * SortVector
+     *  Helper/wrapper function to start sorting a provided vector of courses.
+     * Check for empty vector and sets start and end properly.
+     * Use this function to initiate full-vector sorting.
+     *
+     * @param vector<Course>& coursesVector - the vector of courses to be sorted
+     */
+    static void SortVector(vector<Course>& coursesVector) {
+        if (coursesVector.empty())
+            return;
+
+        if (sortMode == SortMode::Radix)
+            PermutationSort(coursesVector);
+        else
+            Quicksort(coursesVector, 0, coursesVector.size() - 1);
+    }
+
+    /*
+     * RadixSortKeys
+     *  Stable LSD radix sort of (packed key, position) pairs, one byte per pass
+     *
+     * All eight byte histograms are counted in a single pass, and any pass where every
+     * key shares the same byte (such as zero padding or a common department prefix) is skipped.
+     *
+     * @param vector<pair<uint64_t, uint32_t>>& entries - pairs to sort by key
+     */
+    static void RadixSortKeys(vector<pair<uint64_t, uint32_t>>& entries) {
+        vector<size_t> counts(8 * 256, 0);
+        for (const pair<uint64_t, uint32_t>& entry : entries) {
+            for (int digit = 0; digit < 8; digit++)
+                counts[digit * 256 + ((entry.first >> (digit * 8)) & 0xFF)]++;
+        }
+
+        vector<pair<uint64_t, uint32_t>> buffer(entries.size());
+        for (int digit = 0; digit < 8; digit++) {
+            size_t* digitCounts = &counts[digit * 256];
+            if (*max_element(digitCounts, digitCounts + 256) == entries.size())
+                continue; // every key has the same byte here
+
+            // Turn counts into starting offsets, then scatter in order
+            size_t offset = 0;
+            for (int value = 0; value < 256; value++) {
+                size_t count = digitCounts[value];
+                digitCounts[value] = offset;
+                offset += count;
+            }
+            for (const pair<uint64_t, uint32_t>& entry : entries)
+                buffer[digitCounts[(entry.first >> (digit * 8)) & 0xFF]++] = entry;
+            entries.swap(buffer);
+        }
+    }
+
+    /*
+     * PermutationSort
+     *  Sorts courses by computing the sorted order of their keys, then moving each record once
+     *
+     * When every course number fits in a packed key the order comes from RadixSortKeys.
+     * Otherwise the positions are ordered with std::sort (introsort, which has a bounded
+     * recursion depth) comparing course numbers. Either way, the Course records are
+     * moved exactly once instead of being swapped repeatedly.
+     *
+     * @param vector<Course>& coursesVector - the vector of courses to be sorted
+     */
+    static void PermutationSort(vector<Course>& coursesVector) {
+        vector<pair<uint64_t, uint32_t>> entries(coursesVector.size());
+        bool allKeysPacked = true;
+        for (size_t i = 0; i < coursesVector.size() && allKeysPacked; i++) {
+            allKeysPacked = CourseKey::Pack(coursesVector[i].courseNumber, entries[i].first);
+            entries[i].second = static_cast<uint32_t>(i);
+        }
+
+        if (allKeysPacked) {
+            RadixSortKeys(entries);
+        }
+        else {
+            for (size_t i = 0; i < entries.size(); i++)
+                entries[i].second = static_cast<uint32_t>(i);
+            sort(entries.begin(), entries.end(), [&coursesVector](const pair<uint64_t, uint32_t>& a, const pair<uint64_t, uint32_t>& b) {
+                return coursesVector[a.second].courseNumber < coursesVector[b.second].courseNumber;
+            });
+        }
+
+        // Apply the permutation once
+        vector<Course> sorted;
+        sorted.reserve(coursesVector.size());
+        for (const pair<uint64_t, uint32_t>& entry : entries)
+            sorted.push_back(move(coursesVector[entry.second]));
+        coursesVector.swap(sorted);
+    }
+
+    // Result of parsing one newline-aligned slice of the input
+    struct ParsedChunk {
+        vector<Course> courses; // courses parsed from the chunk, in file order
+        StringArena text;       // text of the chunk's courses
+        size_t lineCount = 0;   // lines consumed, including a failed line
+        bool failed = false;    // true if parsing stopped at a bad line
+        string_view failedLine; // the line that could not be parsed
+        bool keepGoing = false; // true to record bad lines and carry on instead of stopping
+        vector<size_t> lines;   // chunk line number of each course, only filled when keepGoing
+        vector<pair<size_t, string_view>> badLines; // chunk line numbers and text of bad lines, only when keepGoing
+    };
+
+    /*
+     * ParseChunk
+     *  Parses every line in [begin, end) into the chunk's course list, stopping at the first bad line
+     * (or, with chunk.keepGoing, noting every bad line and carrying on)
+     *
+     * @param const char* begin - first byte of the chunk (start of a line)
+     * @param const char* end - one past the last byte of the chunk (start of a line or end of buffer)
+     * @param ParsedChunk& chunk - receives the courses, line count and any failure
+     */
+    static void ParseChunk(const char* begin, const char* end, ParsedChunk& chunk) {
+        // One course per line, so reserve once up front instead of growing
+        chunk.courses.reserve(chunk.courses.size() + count(begin, end, '\n') + 1);
+
+        const char* position = begin;
+        while (position < end) {
+            const char* newline = static_cast<const char*>(memchr(position, '\n', end - position));
+            const char* lineEnd = (newline != nullptr) ? newline : end;
+            string_view line(position, lineEnd - position);
+            position = (newline != nullptr) ? newline + 1 : end;
+            chunk.lineCount++;
+
+            chunk.courses.emplace_back();
+            Course& course = chunk.courses.back();
+            bool isScanned = ScanLineIntoCourse(line, chunk.text, course);
+            if (!isScanned && !chunk.keepGoing) {
+                chunk.courses.pop_back();
+                chunk.failed = true;
+                chunk.failedLine = line;
+                return;
+            }
+            if (!isScanned || !IsValidCourseObject(&course)) {
+                chunk.courses.pop_back(); // same outcome as a rejected Insert
+                if (chunk.keepGoing)
+                    chunk.badLines.emplace_back(chunk.lineCount, line);
+            }
+            else if (chunk.keepGoing) {
+                chunk.lines.push_back(chunk.lineCount);
+            }
+        }
+    }
+
+    /*
+     * StoreCourse
+     *  Copies a course's text into an arena
+     *
+     * @param const Course& course - course to copy
+     * @param StringArena& text - arena to store the text in
+     *
+     * @return Course - the same course, viewing the arena's copy
+     */
+    static Course StoreCourse(const Course& course, StringArena& text) {
+        Course stored;
+        stored.courseNumber = text.Store(course.courseNumber);
+        stored.name = text.Store(course.name);
+        if (!course.prerequisites.empty()) {
+            string_view* prerequisites = reinterpret_cast<string_view*>(
+                text.Allocate(course.prerequisites.size() * sizeof(string_view), alignof(string_view)));
+            for (size_t i = 0; i < course.prerequisites.size(); i++)
+                new (&prerequisites[i]) string_view(text.Store(course.prerequisites[i]));
+            stored.prerequisites.first = prerequisites;
+            stored.prerequisites.last = prerequisites + course.prerequisites.size();
+        }
+        return stored;
+    }
+
+    /*
+     * TextBytes
+     *  Bytes a course's text takes up in an arena (see StoreCourse), not counting alignment
+     *
+     * @param const Course& course - course to measure
+     *
+     * @return size_t - byte count
+     */
+    static size_t TextBytes(const Course& course) {
+        size_t bytes = course.courseNumber.size() + course.name.size() + course.prerequisites.size() * sizeof(string_view);
+        for (string_view prerequisite : course.prerequisites)
+            bytes += prerequisite.size();
+        return bytes;
+    }
+
+    /*
+     * RebuildIndex
+     *  Rebuilds the hash index, trie, name index and prerequisite graph from scratch.
+     * Needed after a bulk load or after sorting, since both change course positions.
+     */
+    void RebuildIndex() {
+        courseIndex.Clear();
+        courseIndex.Reserve(courseCollection.size());
+        for (size_t i = 0; i < courseCollection.size(); i++) {
+            courseIndex.Insert(courseCollection, i);
+        }
+        if (isSorted) {
+            courseTrie.Build(courseCollection);
+            nameIndex.Build(courseCollection);
+        }
+        else {
+            courseTrie.Clear();
+            nameIndex.Clear();
+        }
+        prerequisiteGraph.Build(courseCollection, courseIndex);
+        isGraphCurrent = true;
+    }
+
+    /*
+     * EnsureGraph
+     *  Rebuilds the prerequisite graph if courses were inserted since it was built
+     */
+    void EnsureGraph() {
+        if (isGraphCurrent)
+            return;
+
+        prerequisiteGraph.Build(courseCollection, courseIndex);
+        isGraphCurrent = true;
+    }
+
+    /*
+     * PositionOf
+     *  Position of a course object within courseCollection
+     *
+     * @param const Course* course - pointer to check
+     *
+     * @return size_t - the position, or SIZE_MAX if the course is not stored in the collection
+     */
+    size_t PositionOf(const Course* course) const {
+        if (course < courseCollection.data() || course >= courseCollection.data() + courseCollection.size())
+            return SIZE_MAX;
+        return static_cast<size_t>(course - courseCollection.data());
+    }
+
+    /*
+     * EnsureSorted
+     *  Sorts the collection if needed, and re-indexes the moved courses
+     *
+     * @param bool isLazy = true - false when a load sorts the courses it just parsed,
+     *                             which is not counted as a lazy sort
+     */
+    void EnsureSorted(bool isLazy = true) {
+        if (isSorted)
+            return;
+
+        Metrics::Timer timer(Metrics::Timing::Sort);
+        if (isLazy)
+            Metrics::Increment(Metrics::Counter::LazySorts);
+        SortVector(courseCollection);
+        isSorted = true;
+        RebuildIndex();
+    }
+
+    /*
+     * SplitIntoChunks
+     *  Splits a buffer at newline boundaries into a few chunks per thread, which evens out uneven lines
+     *
+     * @param const char* data - first byte of the file contents
+     * @param size_t size - number of bytes in the buffer
+     * @param unsigned threadCount - number of parser threads (already resolved, at least 1)
+     *
+     * @return vector<const char*> - chunk start pointers, followed by the end of the buffer
+     */
+    static vector<const char*> SplitIntoChunks(const char* data, size_t size, unsigned threadCount) {
+        const char* bufferEnd = data + size;
+        size_t chunkCount = (threadCount == 1) ? 1 : static_cast<size_t>(threadCount) * 4;
+        vector<const char*> chunkStarts;
+        chunkStarts.push_back(data);
+        for (size_t i = 1; i < chunkCount; i++) {
+            const char* target = max(data + (size / chunkCount) * i, chunkStarts.back());
+            const char* newline = static_cast<const char*>(memchr(target, '\n', bufferEnd - target));
+            if (newline == nullptr)
+                break;
+            if (newline + 1 > chunkStarts.back() && newline + 1 < bufferEnd)
+                chunkStarts.push_back(newline + 1);
+        }
+        chunkStarts.push_back(bufferEnd);
+        return chunkStarts;
+    }
+
+    /*
+     * ParseBufferIntoCollection
+     *  Replaces the collection with the courses parsed from a buffer (see ReadCoursesFromBuffer)
+     *
+     * @param const char* data - first byte of the file contents
+     * @param size_t size - number of bytes in the buffer
+     * @param unsigned threadCount - number of parser threads (0 uses all cores)
+     *
+     * @return bool - true if every line was parsed; false if loading stopped at a bad line
+     */
+    bool ParseBufferIntoCollection(const char* data, size_t size, unsigned threadCount) {
+        // Clear structure before loading to prevent loading the same data twice
+        courseCollection.clear();
+        courseText.Clear();
+        deadTextBytes = 0;
+        isSorted = false;
+        return ParseBuffer(data, size, threadCount, courseCollection, courseText);
+    }
+
+    /*
+     * ParseBuffer
+     *  Appends the courses parsed from a buffer to a vector, stopping at the first bad line
+     *
+     * @param const char* data - first byte of the file contents
+     * @param size_t size - number of bytes in the buffer
+     * @param unsigned threadCount - number of parser threads (0 uses all cores)
+     * @param vector<Course>& courses - receives the parsed courses, in file order
+     * @param StringArena& text - arena that takes on the text of the parsed courses
+     *
+     * @return bool - true if every line was parsed; false if parsing stopped at a bad line
+     */
+    static bool ParseBuffer(const char* data, size_t size, unsigned threadCount, vector<Course>& courses, StringArena& text) {
+        if (data == nullptr || size == 0)
+            return true;
+
+        threadCount = Utils::ResolveThreadCount(threadCount);
+        const char* bufferEnd = data + size;
+        vector<const char*> chunkStarts = SplitIntoChunks(data, size, threadCount);
+
+        // A single chunk is parsed straight into the destination
+        if (chunkStarts.size() == 2) {
+            ParsedChunk chunk;
+            chunk.courses = move(courses);
+            chunk.text = move(text);
+            ParseChunk(data, bufferEnd, chunk);
+            courses = move(chunk.courses);
+            text = move(chunk.text);
+            if (chunk.failed)
+                cout << "Error parsing file line " << chunk.lineCount << ": " << chunk.failedLine << endl;
+            return !chunk.failed;
+        }
+
+        vector<ParsedChunk> chunks(chunkStarts.size() - 1);
+        Utils::RunParallel(chunks.size(), threadCount, [&](size_t i) {
+            ParseChunk(chunkStarts[i], chunkStarts[i + 1], chunks[i]);
+        });
+
+        // Merge in file order, up to and including the chunk holding the first bad line
+        size_t totalCourses = 0;
+        for (const ParsedChunk& chunk : chunks) {
+            totalCourses += chunk.courses.size();
+            if (chunk.failed)
+                break;
+        }
+        courses.reserve(courses.size() + totalCourses);
+
+        size_t linesBefore = 0;
+        for (ParsedChunk& chunk : chunks) {
+            move(chunk.courses.begin(), chunk.courses.end(), back_inserter(courses));
+            text.Adopt(chunk.text);
+            if (chunk.failed) {
+                cout << "Error parsing file line " << linesBefore + chunk.lineCount << ": " << chunk.failedLine << endl;
+                return false;
+            }
+            linesBefore += chunk.lineCount;
+        }
+        return true;
+    }
+
+/* *****************************
+* Vector Class - Public section
+***************************** */
+public:
+    /*
+     * Vector
+     *  Class constructor
+     * Initializes an empty course collection and sets the sorted flag to false.
+     */
+    Vector() {
+        courseCollection = vector<Course>();
+        deadTextBytes = 0;
+        isSorted = false;
+        isGraphCurrent = false;
+    }
+
+    /*
+     * SortCourses
+     *  Sorts any vector of courses with the selected sort mode (see SortVector)
+     *
+     * @param vector<Course>& coursesVector - the vector of courses to be sorted
+     */
+    static void SortCourses(vector<Course>& coursesVector) {
+        SortVector(coursesVector);
+    }
+
+    /*
+     * SetSortMode
+     *  Selects the sorting algorithm used for every Vector
+     *
+     * @param SortMode mode - Quicksort or Radix
+     */
+    static void SetSortMode(SortMode mode) {
+        sortMode = mode;
+    }
+
+    /*
+     * GetSortMode
+     *  Returns the sorting algorithm in use
+     *
+     * @return SortMode - Quicksort or Radix
+     */
+    static SortMode GetSortMode() {
+        return sortMode;
+    }
+
+    /*
+     * IsValidCourseObject
+     *  Validates that a Course object contains required data
+     *
+     * Checks that the supplied Course pointer is not null and contains
+     * both a course number and name.
+     *
+     * @param Course* course - pointer to the Course object to validate
+     *
+     * @return bool - true if the Course object is valid; otherwise false
+     */
+    static bool IsValidCourseObject(Course* course) {
+        if (course == nullptr)
+            return false;
+        if (course->courseNumber.empty())
+            return false;
+        if (course->name.empty())
+            return false;
+        return true;
+    }
+
+    /*
+     * IsSorted
+     *  Indicates whether the collection is currently in course number order
+     *
+     * @return bool - true if sorted; otherwise false
+     */
+    bool IsSorted() const {
+        return isSorted;
+    }
+
+    /*
+     * IsEmpty
+     *  Indicates whether any courses have been loaded
+     *
+     * Returns true if the internal course collection contains no data.
+     *
+     * @return bool - true if no courses are loaded; otherwise false
+     */
+    bool IsEmpty() const {
+        return courseCollection.empty();
+    }
+
+    /*
+     * GetCourses
+     *  Gives read-only access to the loaded courses, in their current order
+     *
+     * @return const vector<Course>& - the course collection
+     */
+    const vector<Course>& GetCourses() const {
+        return courseCollection;
+    }
+
+    /*
+     * MemoryFootprint
+     *  Estimates the heap and object memory held by the collection
+     *
+     * Counts the course records, the arena blocks holding their text, and the
+     * trie and name index. Allocator overhead is not included.
+     *
+     * @return size_t - estimated bytes used
+     */
+    size_t MemoryFootprint() const {
+        return courseCollection.capacity() * sizeof(Course) + courseText.MemoryFootprint()
+            + courseTrie.MemoryFootprint() + nameIndex.MemoryFootprint();
+    }
+
+    /*
+     * ScanLineIntoCourse
+     *  Parses a single comma-separated line, in place, into an existing Course object
+     *
+     * The first field is the course number, the second the course name, and any
+     * remaining fields are prerequisites; blank prerequisite fields are ignored.
+     * The raw bytes are scanned for commas directly, and each field is trimmed and
+     * uppercased as it is copied into the arena, so the record is built once with
+     * no intermediate strings. A trailing carriage return (Windows line ending) is ignored.
+     *
+     * @param string_view line - raw line from the input, without its newline
+     * @param StringArena& text - arena that stores the course's text
+     * @param Course& course - destination, its fields are overwritten
+     *
+     * @return bool - true if the required fields were present; otherwise false
+     */
+    static bool ScanLineIntoCourse(string_view line, StringArena& text, Course& course) {
+        if (!line.empty() && line.back() == '\r')
+            line.remove_suffix(1);
+
+        const char* position = line.data();
+        const char* lineEnd = position + line.size();
+        bool hasMoreFields = true;
+
+        // Returns the next field and moves past its comma
+        auto nextField = [&position, &hasMoreFields, lineEnd]() {
+            const char* comma = static_cast<const char*>(memchr(position, ',', lineEnd - position));
+            const char* fieldEnd = (comma != nullptr) ? comma : lineEnd;
+            string_view field(position, fieldEnd - position);
+            hasMoreFields = (comma != nullptr);
+            position = hasMoreFields ? comma + 1 : lineEnd;
+            return field;
+        };
+
+        // The course number and name are both required
+        string_view numberField = nextField();
+        if (!hasMoreFields)
+            return false;
+        string_view nameField = nextField();
+        if (numberField.empty() || nameField.empty())
+            return false;
+
+        course.courseNumber = text.StoreTrimmedUppercase(numberField);
+        course.name = text.Store(nameField); // leading/trailing spaces do not matter for course names
+        course.prerequisites = PrerequisiteList();
+        if (!hasMoreFields)
+            return true;
+
+        // Room for every remaining field, then add prerequisites, but skip blank ones
+        size_t fieldCount = static_cast<size_t>(count(position, lineEnd, ',')) + 1;
+        string_view* prerequisites = reinterpret_cast<string_view*>(text.Allocate(fieldCount * sizeof(string_view), alignof(string_view)));
+        size_t prerequisiteCount = 0;
+        while (hasMoreFields) {
+            string_view prerequisiteField = nextField();
+            if (prerequisiteField.find_first_not_of(' ') == string_view::npos)
+                continue;
+            new (&prerequisites[prerequisiteCount++]) string_view(text.StoreTrimmedUppercase(prerequisiteField));
+        }
+        course.prerequisites.first = prerequisites;
+        course.prerequisites.last = prerequisites + prerequisiteCount;
+
+        return true;
+    }
+
+    /*
+     * Search
+     *  Looks up a course by course number
+     *
+     * Locates a course through the hash index in constant expected time.
+     * The index is kept current by every load and Insert, so no sorting is needed.
+     *
+     * @param string_view courseNumber - the course number to search for
+     *
+     * @return Course* - pointer to the matching Course if found; otherwise nullptr
+     */
+    Course* Search(string_view courseNumber) {
+        Metrics::Increment(Metrics::Counter::Searches);
+        size_t position = courseIndex.Find(courseCollection, courseNumber);
+        if (position == SIZE_MAX) {
+            Metrics::Increment(Metrics::Counter::SearchMisses);
+            return nullptr;
+        }
+
+        return &courseCollection[position];
+    }
+
+    /*
+     * Search
+     *  Read-only overload of Search, safe to call from several threads at once
+     *
+     * @param string_view courseNumber - the course number to search for
+     *
+     * @return const Course* - pointer to the matching Course if found; otherwise nullptr
+     */
+    const Course* Search(string_view courseNumber) const {
+        Metrics::Increment(Metrics::Counter::Searches);
+        size_t position = courseIndex.Find(courseCollection, courseNumber);
+        if (position == SIZE_MAX) {
+            Metrics::Increment(Metrics::Counter::SearchMisses);
+            return nullptr;
+        }
+
+        return &courseCollection[position];
+    }
+
+    /*
+     * FindPrefix
+     *  Finds every course whose number starts with a prefix, e.g. "CSCI3" for all CSCI3xx courses
+     *
+     * Two binary searches on the sorted collection bound the matching slice, so the
+     * cost is logarithmic in the catalog size. The collection must be sorted, which
+     * every load and Finalize guarantee; an unsorted collection gives an empty result.
+     *
+     * @param string_view prefix - course number prefix
+     *
+     * @return pair<size_t, size_t> - [first, last) positions of the matching courses
+     */
+    pair<size_t, size_t> FindPrefix(string_view prefix) const {
+        if (!isSorted)
+            return { 0, 0 };
+
+        auto first = partition_point(courseCollection.begin(), courseCollection.end(), [prefix](const Course& course) {
+            return string_view(course.courseNumber) < prefix;
+        });
+        auto last = partition_point(first, courseCollection.end(), [prefix](const Course& course) {
+            return string_view(course.courseNumber).substr(0, prefix.size()) == prefix;
+        });
+        return { static_cast<size_t>(first - courseCollection.begin()), static_cast<size_t>(last - courseCollection.begin()) };
+    }
+
+    /*
+     * FindRange
+     *  Finds every course whose number lies between two course numbers, both included
+     *
+     * Uses lower and upper bound searches on the sorted collection (see FindPrefix).
+     *
+     * @param string_view low - first course number of the range
+     * @param string_view high - last course number of the range
+     *
+     * @return pair<size_t, size_t> - [first, last) positions of the matching courses
+     */
+    pair<size_t, size_t> FindRange(string_view low, string_view high) const {
+        if (!isSorted || high < low)
+            return { 0, 0 };
+
+        auto first = partition_point(courseCollection.begin(), courseCollection.end(), [low](const Course& course) {
+            return string_view(course.courseNumber) < low;
+        });
+        auto last = partition_point(first, courseCollection.end(), [high](const Course& course) {
+            return string_view(course.courseNumber) <= high;
+        });
+        return { static_cast<size_t>(first - courseCollection.begin()), static_cast<size_t>(last - courseCollection.begin()) };
+    }
+
+    /*
+     * FindSpan
+     *  Runs a prefix query ("CSCI3") or an inclusive range query ("MATH200-MATH299")
+     *
+     * @param string_view query - a prefix, or two course numbers separated by '-'
+     *
+     * @return pair<size_t, size_t> - [first, last) positions of the matching courses
+     */
+    pair<size_t, size_t> FindSpan(string_view query) const {
+        size_t dash = query.find('-');
+        if (dash == string_view::npos)
+            return FindPrefix(query);
+
+        string low;
+        string high;
+        Utils::TrimAndUppercaseInto(query.substr(0, dash), low);
+        Utils::TrimAndUppercaseInto(query.substr(dash + 1), high);
+        return FindRange(low, high);
+    }
+
+    /*
+     * Autocomplete
+     *  Completes a partial course number as far as the catalog allows, using the trie
+     *
+     * @param string_view partial - the characters typed so far
+     * @param string& completion - receives the longest completion shared by every match
+     *
+     * @return pair<size_t, size_t> - [first, last) positions of the courses starting with partial
+     */
+    pair<size_t, size_t> Autocomplete(string_view partial, string& completion) const {
+        if (!isSorted) {
+            completion.assign(partial.data(), partial.size());
+            return { 0, 0 };
+        }
+        return courseTrie.Complete(partial, completion);
+    }
+
+    /*
+     * SearchNames
+     *  Finds courses by words of their names, e.g. "operating systems" or "program* OR algorithms"
+     *
+     * Answers from the name index built at load time instead of scanning every name;
+     * see NameIndex::Query for the query syntax and ranking. Like FindPrefix, this needs
+     * the sorted collection that every load and Finalize produce.
+     *
+     * @param string_view query - keyword query
+     * @param size_t limit - maximum number of ranked positions to return
+     * @param vector<uint32_t>& ranked - receives the positions of the best matches, best first
+     *
+     * @return size_t - total number of matching courses
+     */
+    size_t SearchNames(string_view query, size_t limit, vector<uint32_t>& ranked) const {
+        if (!isSorted) {
+            ranked.clear();
+            return 0;
+        }
+        return nameIndex.Query(query, limit, ranked);
+    }
+
+    /*
+     * FindMissingPrerequisites
+     *  Verifies that each listed prerequisite exists, using the prerequisite graph's
+     * side table of unresolved prerequisites (built once at load).
+     * Returns the first course found that fails validation or nullptr if all courses are valid.
+     *
+     * @return Course* - pointer to the first course found with a missing prerequisite,
+     *                   or nullptr if all prerequisites are valid
+     */
+    Course* FindMissingPrerequisites() {
+        EnsureGraph();
+        const vector<PrerequisiteGraph::UnresolvedPrerequisite>& unresolved = prerequisiteGraph.GetUnresolved();
+        if (unresolved.empty())
+            return nullptr;
+        return &courseCollection[unresolved.front().course];
+    }
+
+    /*
+     * GetPrerequisiteGraph
+     *  Gives read-only access to the resolved prerequisite graph, rebuilding it first if needed
+     *
+     * @return const PrerequisiteGraph& - graph over the current collection positions
+     */
+    const PrerequisiteGraph& GetPrerequisiteGraph() {
+        EnsureGraph();
+        return prerequisiteGraph;
+    }
+
+    /*
+     * GetPrerequisiteGraph
+     *  Read-only overload for a finalized catalog (see Finalize), safe to call from several threads at once
+     *
+     * @return const PrerequisiteGraph& - graph over the current collection positions
+     */
+    const PrerequisiteGraph& GetPrerequisiteGraph() const {
+        return prerequisiteGraph;
+    }
+
+    /*
+     * Finalize
+     *  Completes any deferred sorting, indexing and graph building
+     *
+     * After this call every const query (Search, FormatCourse, GetCourses) answers
+     * from finished structures and changes nothing, so a finalized Vector can be
+     * shared between threads as long as no non-const method is called on it.
+     */
+    void Finalize() {
+        EnsureSorted();
+        EnsureGraph();
+    }
+
+    /*
+     * Insert
+     *  Adds a Course object to the collection
+     *
+     * Copies a validated Course's text into the collection's arena, adds the
+     * record to the internal vector and the hash index, and marks the
+     * collection as unsorted.
+     *
+     * @param Course* course - pointer to the Course object to insert
+     *
+     * @return bool - true if the course was inserted; otherwise false
+     */
+    bool Insert(Course* course) {
+        if (!IsValidCourseObject(course))
+            return false;
+
+        courseCollection.push_back(StoreCourse(*course, courseText));
+        courseIndex.Insert(courseCollection, courseCollection.size() - 1);
+        isSorted = false;
+        isGraphCurrent = false;
+        return true;
+    }
+
+    /*
+     * FormatCourse
+     *  Appends a single course's information to a text buffer, without a trailing newline
+     *
+     * Produces the same text as PrintCourse. Appending to a caller-owned buffer means
+     * many courses can be formatted without building temporary strings or flushing
+     * the output after every line.
+     *
+     * @param const Course* course - pointer to the Course to format
+     * @param bool includePrerequisites - whether to include prerequisite information
+     * @param string& output - buffer the text is appended to
+     */
+    void FormatCourse(const Course* course, bool includePrerequisites, string& output) const {
+        if (course == nullptr || course->courseNumber.empty() || course->name.empty())
+            return;
+
+        // Print line has been adjusted from Pseudocode to match example provided for this assignment:
+        //   Example Lines: 
+        // CSCI400, Large Software Development
+        // Prerequisites: CSCI301, CSCI350
+        // HOWEVER the instructions specify: "You will then print the name of the course and the prerequisite course numbers and titles."
+        // So line 2 has been updated to:
+        // Prerequisites: CSCI301, Advanced Programming in C++; CSCI350, Operating Systems
+        output.append(course->courseNumber).append(", ").append(course->name);
+        if (!includePrerequisites) // Not printing prerequisits
+            return;
+
+        output.append("\nPrerequisites: ");
+        if (course->prerequisites.empty()) {
+            output.append("None");
+            return;
+        }
+
+        size_t infoStart = output.size();
+        size_t position = PositionOf(course);
+        if (position != SIZE_MAX && isGraphCurrent) {
+            // Walk the resolved edges, then name any prerequisites missing from the catalog
+            for (uint32_t prerequisite : prerequisiteGraph.Prerequisites(position)) {
+                const Course& tempCourse = courseCollection[prerequisite];
+                output.append(tempCourse.courseNumber).append(", ").append(tempCourse.name).append("; ");
+            }
+            pair<size_t, size_t> missing = prerequisiteGraph.UnresolvedFor(position);
+            for (size_t i = missing.first; i < missing.second; i++) {
+                output.append(prerequisiteGraph.GetUnresolved()[i].prerequisite).append(", (not found in catalog); ");
+            }
+        }
+        else {
+            for (string_view prereq : course->prerequisites) {
+                const Course* tempCourse = Search(prereq);
+                if (tempCourse != nullptr) {
+                    output.append(tempCourse->courseNumber).append(", ").append(tempCourse->name).append("; ");
+                }
+            }
+        }
+
+        if (output.size() > infoStart)
+            output.resize(output.size() - 2); // drop the final "; "
+        else
+            output.append("Error: Prerequisites expected, but none found");
+    }
+
+    /*
+     * PrintCourse
+     *  Prints a single course's information
+     *
+     * Outputs the course number and name, and optionally its prerequisites.
+     *
+     * @param Course* course - pointer to the Course to print
+     * @param bool includePrerequisites - whether to include prerequisite information
+     */
+    void PrintCourse(Course* course, bool includePrerequisites = false) {
         if (!IsValidCourseObject(course))
+            return;
+
+        if (includePrerequisites)
+            EnsureGraph();
+
+        // Print on 1 or 2 lines, depending on whether prerequisites are included
+        string courseInfo;
+        FormatCourse(course, includePrerequisites, courseInfo);
+        cout << courseInfo << endl;
+    }
+
+    /*
+     * PrintAllCourses
+     *  Prints all stored courses in sorted order
+     *
+     * Sorts the collection if needed and prints each course without
+     * prerequisite details.
+     */
+    void PrintAllCourses() {
+        EnsureSorted();
+
+        for (Course& course : courseCollection) {
+            PrintCourse(&course); // print course, but without prerequisits
+        }
+    }
+
+    /*
+     * ReadCoursesFromFile
+     *  Loads courses from an open input file
+     *
+     * Reads the file line-by-line and builds each Course directly in the
+     * collection, with its text in the collection's arena.
+     *
+     * @param ifstream& file - reference to an open file stream containing course data
+     */
+    void ReadCoursesFromFile(ifstream& file) {
+        if (!file.is_open())
+            return;
+
+        // Clear structure before loading to prevent loading the same data twice
+        courseCollection.clear();
+        courseText.Clear();
+        deadTextBytes = 0;
+        courseIndex.Clear();
+        isSorted = false;
+        isGraphCurrent = false;
+
+        string line;
+        size_t lineNumber = 0;
+        while (getline(file, line)) {
+            lineNumber++;
+            courseCollection.emplace_back();
+            Course& course = courseCollection.back();
+            if (!ScanLineIntoCourse(line, courseText, course)) {
+                courseCollection.pop_back();
+                cout << "Error parsing file line " << lineNumber << ": " << line << endl;
+                return;
+            }
+            if (!IsValidCourseObject(&course)) {
+                courseCollection.pop_back();
+                continue;
+            }
+            courseIndex.Insert(courseCollection, courseCollection.size() - 1);
+        }
+    }
+
+    /*
+     * ReadCoursesFromBuffer
+     *  Loads courses from an in-memory copy of the input file
+     *
+     * Scans the buffer for newlines and commas in place and builds each Course
+     * directly in the collection, so no line strings, field strings or temporary
+     * Course objects are created. Parsing rules match ReadCoursesFromFile.
+     *
+     * With more than one thread the buffer is split into chunks at newline
+     * boundaries, the chunks are parsed concurrently and the results are merged
+     * back in file order. As with a single thread, loading stops at the first
+     * line that cannot be parsed, and the line is reported with its file line number.
+     *
+     * The loaded collection is sorted and indexed before returning, so course
+     * positions stay stable for later queries.
+     *
+     * @param const char* data - first byte of the file contents
+     * @param size_t size - number of bytes in the buffer
+     * @param unsigned threadCount = 1 - number of parser threads (0 uses all cores)
+     *
+     * @return bool - true if every line was parsed; false if loading stopped at a bad line
+     */
+    bool ReadCoursesFromBuffer(const char* data, size_t size, unsigned threadCount = 1) {
+        Metrics::Timer timer(Metrics::Timing::Load);
+        bool isComplete = ParseBufferIntoCollection(data, size, threadCount);
+        isSorted = false;
+        EnsureSorted(false);
+        Metrics::Set(Metrics::Gauge::CatalogCourses, courseCollection.size());
+        Metrics::Set(Metrics::Gauge::CatalogBytes, MemoryFootprint());
+        return isComplete;
+    }
+
+    /*
+     * ReadCoursesFromMappedFile
+     *  Loads courses from a memory-mapped input file
+     *
+     * @param const MappedFile& file - mapped file containing course data
+     * @param unsigned threadCount = 1 - number of parser threads (0 uses all cores)
+     *
+     * @return bool - true if every line was parsed; false if loading stopped at a bad line
+     */
+    bool ReadCoursesFromMappedFile(const MappedFile& file, unsigned threadCount = 1) {
+        return ReadCoursesFromBuffer(file.Data(), file.Size(), threadCount);
+    }
+
+    /*
+     * ParseBufferKeepingGoing
+     *  Parses a whole buffer in parallel without stopping at bad lines
+     *
+     * The continue-on-error form of the loader's parser, used for validation: every
+     * course keeps the line number it came from, and every line that could not be
+     * turned into a course is returned instead of ending the parse.
+     *
+     * @param const char* data - first byte of the file contents
+     * @param size_t size - number of bytes in the buffer
+     * @param unsigned threadCount - number of parser threads (0 uses all cores)
+     * @param vector<Course>& courses - receives the courses, in file order
+     * @param vector<size_t>& lines - receives the line number of each course
+     * @param vector<ParseError>& errors - receives the bad lines, in file order
+     * @param StringArena& text - arena that takes on the text of the parsed courses
+     *
+     * @return size_t - number of lines in the buffer
+     */
+    static size_t ParseBufferKeepingGoing(const char* data, size_t size, unsigned threadCount, vector<Course>& courses,
+                                          vector<size_t>& lines, vector<ParseError>& errors, StringArena& text) {
+        courses.clear();
+        lines.clear();
+        errors.clear();
+        if (data == nullptr || size == 0)
+            return 0;
+
+        vector<const char*> chunkStarts = SplitIntoChunks(data, size, Utils::ResolveThreadCount(threadCount));
+        vector<ParsedChunk> chunks(chunkStarts.size() - 1);
+        Utils::RunParallel(chunks.size(), threadCount, [&](size_t i) {
+            chunks[i].keepGoing = true;
+            ParseChunk(chunkStarts[i], chunkStarts[i + 1], chunks[i]);
+        });
+
+        // Merge in file order, turning chunk line numbers into file line numbers
+        size_t totalCourses = 0;
+        for (const ParsedChunk& chunk : chunks)
+            totalCourses += chunk.courses.size();
+        courses.reserve(totalCourses);
+        lines.reserve(totalCourses);
+
+        size_t linesBefore = 0;
+        for (ParsedChunk& chunk : chunks) {
+            move(chunk.courses.begin(), chunk.courses.end(), back_inserter(courses));
+            text.Adopt(chunk.text);
+            for (size_t line : chunk.lines)
+                lines.push_back(linesBefore + line);
+            for (const pair<size_t, string_view>& badLine : chunk.badLines)
+                errors.push_back(ParseError{ linesBefore + badLine.first, string(badLine.second.substr(0, badLine.second.find_last_not_of('\r') + 1)) });
+            linesBefore += chunk.lineCount;
+        }
+        return linesBefore;
+    }
+
+    /*
+     * ReloadCoursesFromMappedFile
+     *  Brings the catalog up to date with a changed input file by applying only the differences
+     *
+     * The new file is parsed and sorted on its own, then merged against the sorted
+     * collection in one pass. Unchanged courses are moved across untouched, and only
+     * new and changed courses have their text copied into the catalog's arena, so the
+     * result stays sorted without a full re-sort. The indexes are patched rather than
+     * rebuilt: the hash index erases removed courses, moves the rest to their new
+     * positions and adds the new ones; the trie adds and removes only the changed
+     * numbers; the name index reads only new and renamed names; and the prerequisite
+     * graph resolves only the rows that may have changed. Text left behind by removed
+     * and replaced courses is reclaimed once it makes up more than half of the arena.
+     * If the new file has a bad line, the reload is abandoned and the current catalog
+     * is kept, rather than replacing it with a partial file.
+     *
+     * @param const MappedFile& file - mapped file containing the new course data
+     * @param unsigned threadCount = 1 - number of parser threads (0 uses all cores)
+     *
+     * @return ReloadSummary - counts of inserted, updated, deleted and unchanged courses, and the time taken
+     */
+    ReloadSummary ReloadCoursesFromMappedFile(const MappedFile& file, unsigned threadCount = 1) {
+        auto started = chrono::steady_clock::now();
+        ReloadSummary summary;
+
+        vector<Course> incoming;
+        StringArena incomingText;
+        if (!ParseBuffer(file.Data(), file.Size(), threadCount, incoming, incomingText))
+            return summary;
+        incoming.erase(remove_if(incoming.begin(), incoming.end(), [](Course& course) { return !IsValidCourseObject(&course); }), incoming.end());
+        SortVector(incoming);
+        EnsureSorted();
+        EnsureGraph();
+
+        vector<Course> merged;
+        merged.reserve(incoming.size());
+        vector<uint32_t> newPositions(courseCollection.size(), UINT32_MAX); // old position to new, for numbers still listed
+        vector<uint32_t> sources;    // new position to old, for unchanged courses only
+        vector<uint32_t> added;      // new positions of inserted courses
+        vector<uint32_t> named;      // new positions of inserted and renamed courses
+        vector<uint32_t> removed;    // old positions of deleted courses
+        vector<uint32_t> renamed;    // old positions of renamed courses
+        sources.reserve(incoming.size());
+        size_t oldPosition = 0;
+        size_t newPosition = 0;
+        while (oldPosition < courseCollection.size() || newPosition < incoming.size()) {
+            if (newPosition == incoming.size()
+                || (oldPosition < courseCollection.size() && courseCollection[oldPosition].courseNumber < incoming[newPosition].courseNumber)) {
+                summary.deleted++;
+                deadTextBytes += TextBytes(courseCollection[oldPosition]);
+                removed.push_back(static_cast<uint32_t>(oldPosition++));
+            }
+            else if (oldPosition == courseCollection.size() || incoming[newPosition].courseNumber < courseCollection[oldPosition].courseNumber) {
+                summary.inserted++;
+                added.push_back(static_cast<uint32_t>(merged.size()));
+                named.push_back(static_cast<uint32_t>(merged.size()));
+                sources.push_back(UINT32_MAX);
+                merged.push_back(StoreCourse(incoming[newPosition++], courseText));
+            }
+            else {
+                Course& oldCourse = courseCollection[oldPosition];
+                Course& newCourse = incoming[newPosition++];
+                newPositions[oldPosition] = static_cast<uint32_t>(merged.size());
+                if (oldCourse.name == newCourse.name && oldCourse.prerequisites == newCourse.prerequisites) {
+                    summary.unchanged++;
+                    sources.push_back(static_cast<uint32_t>(oldPosition));
+                    merged.push_back(move(oldCourse));
+                }
+                else {
+                    summary.updated++;
+                    if (oldCourse.name != newCourse.name) {
+                        named.push_back(static_cast<uint32_t>(merged.size()));
+                        renamed.push_back(static_cast<uint32_t>(oldPosition));
+                    }
+                    deadTextBytes += TextBytes(oldCourse);
+                    sources.push_back(UINT32_MAX);
+                    merged.push_back(StoreCourse(newCourse, courseText));
+                }
+                oldPosition++;
+            }
+        }
+
+        // Erase while the entries can still be compared against the old collection
+        for (uint32_t position : removed)
+            courseIndex.Erase(courseCollection, position);
+        courseCollection.swap(merged);
+        vector<Course>& previous = merged; // the old records, still viewing courseText
+        isSorted = true;
+
+        if (summary.inserted > 0 || summary.deleted > 0) {
+            courseIndex.Remap(newPositions);
+            for (uint32_t position : added) {
+                courseIndex.Insert(courseCollection, position);
+                courseTrie.Insert(courseCollection[position].courseNumber);
+            }
+
+            // A removed duplicate may share its number with a course that is still listed
+            for (uint32_t position : removed) {
+                string_view courseNumber = previous[position].courseNumber;
+                auto listed = lower_bound(courseCollection.begin(), courseCollection.end(), courseNumber,
+                                          [](const Course& course, string_view value) { return course.courseNumber < value; });
+                if (listed != courseCollection.end() && listed->courseNumber == courseNumber)
+                    courseIndex.Insert(courseCollection, static_cast<size_t>(listed - courseCollection.begin()));
+                else
+                    courseTrie.Remove(courseNumber);
+            }
+            if (courseTrie.IsFragmented())
+                courseTrie.Build(courseCollection);
+            else
+                courseTrie.UpdateBounds(courseCollection);
+        }
+
+        if (summary.inserted > 0 || summary.deleted > 0 || !renamed.empty()) {
+            vector<uint32_t> namePositions = newPositions;
+            for (uint32_t position : renamed)
+                namePositions[position] = UINT32_MAX;
+            nameIndex.Patch(namePositions, courseCollection, named);
+        }
+
+        if (deadTextBytes * 2 > courseText.MemoryFootprint()) {
+            // Mostly dead text: copy the live text into a fresh arena. The graph's views of
+            // missing prerequisites point into the old one, so the graph is built again.
+            StringArena compacted;
+            for (Course& course : courseCollection)
+                course = StoreCourse(course, compacted);
+            courseText = move(compacted);
+            deadTextBytes = 0;
+            prerequisiteGraph.Build(courseCollection, courseIndex);
+        }
+        else if (summary.inserted > 0 || summary.updated > 0 || summary.deleted > 0) {
+            prerequisiteGraph.Patch(courseCollection, courseIndex, newPositions, sources, summary.inserted > 0);
+        }
+        isGraphCurrent = true;
+
+        summary.applied = true;
+        summary.seconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+        Metrics::Record(Metrics::Timing::Reload, static_cast<uint64_t>(summary.seconds * 1e9));
+        Metrics::Set(Metrics::Gauge::CatalogCourses, courseCollection.size());
+        Metrics::Set(Metrics::Gauge::CatalogBytes, MemoryFootprint());
+        return summary;
+    }
+};
+
+
+/* *****************************
+ * SharedCatalog Class
+ ***************************** */
+
+// Immutable catalog versions that readers use while the next version is built
+//
+// Readers are lock-free: taking a version is a plain atomic load of the current pointer,
+// a store of that pointer into a reader slot (normally one this thread used last, on its
+// own cache line) and a second load to check it was not replaced meanwhile. Readers never
+// take a mutex, never touch a shared reference count and only retry when a version is
+// published between their two loads. Writers are serialized by a mutex and free a replaced
+// version once no reader slot holds it (hazard pointers).
+class SharedCatalog {
+private:
+    // One reader's claim on a version; slots are only ever added, and are reused once released
+    struct alignas(64) ReaderSlot {
+        atomic<const Vector*> held{ nullptr }; // version in use, nullptr when the slot is free
+        ReaderSlot* next = nullptr;            // next slot in the list
+    };
+
+    // Reader slot this thread used last, checked first by its next Acquire
+    struct SlotHint {
+        uint64_t catalogId = 0; // instanceId of the catalog the slot belongs to
+        ReaderSlot* slot = nullptr;
+    };
+
+    inline static atomic<uint64_t> nextInstanceId{ 1 }; // source of instanceId values
+
+    atomic<const Vector*> current;           // published version
+    mutable atomic<ReaderSlot*> readerSlots; // head of the reader slot list, grown by Acquire
+    uint64_t instanceId;                     // tells apart the slot hints of different catalogs
+    mutex publishMutex;                      // serializes writers and guards retired
+    vector<const Vector*> retired;           // replaced versions that a reader may still hold
+    atomic<uint64_t> version;                // number of versions published so far
+    atomic<bool> isBuilding;                 // flag to show if a background reload is running
+    thread builder;                          // background thread building the next version
+    ReloadSummary lastSummary;               // outcome of the last background reload, read after WaitForReload
+
+    /*
+     * ClaimSlot
+     *  Stores a version into a free reader slot, adding a slot if all are taken
+     *
+     * @param const Vector* held - version to hold
+     *
+     * @return ReaderSlot* - the claimed slot
+     */
+    ReaderSlot* ClaimSlot(const Vector* held) const {
+        thread_local SlotHint hint;
+        const Vector* free = nullptr;
+        if (hint.catalogId == instanceId && hint.slot->held.compare_exchange_strong(free, held))
+            return hint.slot;
+
+        ReaderSlot* slot = readerSlots.load(memory_order_acquire);
+        for (; slot != nullptr; slot = slot->next) {
+            free = nullptr;
+            if (slot->held.load(memory_order_relaxed) == nullptr && slot->held.compare_exchange_strong(free, held))
+                break;
+        }
+        if (slot == nullptr) {
+            slot = new ReaderSlot();
+            slot->held.store(held);
+            ReaderSlot* head = readerSlots.load(memory_order_relaxed);
+            do {
+                slot->next = head;
+            } while (!readerSlots.compare_exchange_weak(head, slot));
+        }
+        hint.catalogId = instanceId;
+        hint.slot = slot;
+        return slot;
+    }
+
+    /*
+     * FreeUnheldVersions
+     *  Deletes every retired version that no reader slot holds; publishMutex must be held
+     */
+    void FreeUnheldVersions() {
+        vector<const Vector*> held;
+        for (ReaderSlot* slot = readerSlots.load(); slot != nullptr; slot = slot->next) {
+            const Vector* version = slot->held.load();
+            if (version != nullptr)
+                held.push_back(version);
+        }
+        sort(held.begin(), held.end());
+
+        size_t kept = 0;
+        for (const Vector* version : retired) {
+            if (binary_search(held.begin(), held.end(), version))
+                retired[kept++] = version;
+            else
+                delete version;
+        }
+        retired.resize(kept);
+    }
+
+public:
+    // A reader's hold on one catalog version; the version is not freed while this is alive
+    class Snapshot {
+    private:
+        const Vector* courses; // version held
+        ReaderSlot* slot;      // reader slot holding it, released by the destructor
+
+    public:
+        Snapshot(const Vector* held, ReaderSlot* readerSlot) : courses(held), slot(readerSlot) {
+        }
+
+        Snapshot(Snapshot&& other) noexcept : courses(other.courses), slot(other.slot) {
+            other.slot = nullptr;
+        }
+
+        Snapshot(const Snapshot&) = delete;
+        Snapshot& operator=(const Snapshot&) = delete;
+        Snapshot& operator=(Snapshot&&) = delete;
+
+        ~Snapshot() {
+            if (slot != nullptr)
+                slot->held.store(nullptr, memory_order_release);
+        }
+
+        const Vector& operator*() const { return *courses; }
+        const Vector* operator->() const { return courses; }
+    };
+
+    /*
+     * SharedCatalog
+     *  Class constructor
+     * Publishes an empty catalog, so Acquire never returns an empty snapshot.
+     */
+    SharedCatalog() : current(new Vector()), readerSlots(nullptr), instanceId(nextInstanceId++), version(0), isBuilding(false) {
+    }
+
+    SharedCatalog(const SharedCatalog&) = delete;
+    SharedCatalog& operator=(const SharedCatalog&) = delete;
+
+    /*
+     * ~SharedCatalog
+     *  Class destructor
+     * Waits for a running background reload, then frees every version and reader slot.
+     * No Snapshot may outlive the catalog.
+     */
+    ~SharedCatalog() {
+        WaitForReload();
+        for (const Vector* version : retired)
+            delete version;
+        delete current.load();
+        for (ReaderSlot* slot = readerSlots.load(); slot != nullptr;) {
+            ReaderSlot* next = slot->next;
+            delete slot;
+            slot = next;
+        }
+    }
+
+    /*
+     * Acquire
+     *  Takes a hold on the current catalog version
+     *
+     * The returned version never changes. Keep the snapshot for the whole query and
+     * the version stays alive even if a newer one is published meanwhile; it is
+     * freed by the first Publish after its last reader lets go of it.
+     *
+     * @return Snapshot - the current, finalized catalog
+     */
+    Snapshot Acquire() const {
+        const Vector* held = current.load();
+        ReaderSlot* slot = ClaimSlot(held);
+        for (const Vector* latest = current.load(); latest != held; latest = current.load()) {
+            held = latest;
+            slot->held.store(held);
+        }
+        return Snapshot(held, slot);
+    }
+
+    /*
+     * Publish
+     *  Finalizes a catalog and makes it the current version
+     *
+     * @param Vector&& next - the new catalog; it is moved into the shared version
+     */
+    void Publish(Vector&& next) {
+        next.Finalize();
+        const Vector* published = new Vector(move(next));
+        lock_guard<mutex> lock(publishMutex);
+        retired.push_back(current.exchange(published));
+        version++;
+        FreeUnheldVersions();
+    }
+
+    /*
+     * Version
+     *  Number of catalog versions published so far
+     *
+     * @return uint64_t - published version count
+     */
+    uint64_t Version() const {
+        return version.load();
+    }
+
+    /*
+     * Load
+     *  Loads a course file into a new version and publishes it
+     *
+     * @param const string& filePath - course file to load
+     * @param unsigned threadCount = 1 - number of parser threads (0 uses all cores)
+     */
+    void Load(const string& filePath, unsigned threadCount = 1) {
+        MappedFile file = Utils::MapFile(filePath);
+        Vector next;
+        next.ReadCoursesFromMappedFile(file, threadCount);
+        Publish(move(next));
+    }
+
+    /*
+     * StartReload
+     *  Starts building the next version from a changed course file on a background thread
+     *
+     * The builder copies the current version, applies the file's differences to the
+     * copy (see Vector::ReloadCoursesFromMappedFile) and publishes it if anything
+     * changed. Readers keep using the current version until then.
+     *
+     * @param const string& filePath - course file to reload
+     * @param unsigned threadCount = 1 - number of parser threads (0 uses all cores)
+     *
+     * @return bool - true if the reload was started; false if one is already running
+     */
+    bool StartReload(const string& filePath, unsigned threadCount = 1) {
+        if (isBuilding.exchange(true))
+            return false;
+        if (builder.joinable())
+            builder.join();
+
+        builder = thread([this, filePath, threadCount]() {
+            ReloadSummary summary;
+            try {
+                MappedFile file(filePath);
+                Vector next(*Acquire());
+                summary = next.ReloadCoursesFromMappedFile(file, threadCount);
+                if (summary.applied && (summary.inserted > 0 || summary.updated > 0 || summary.deleted > 0))
+                    Publish(move(next));
+            }
+            catch (const exception&) {
+                summary = ReloadSummary(); // file could not be opened, keep the current version
+            }
+            lastSummary = summary;
+            isBuilding = false;
+        });
+        return true;
+    }
+
+    /*
+     * IsReloading
+     *  Checks whether a background reload is still running
+     *
+     * @return bool - true while the builder thread is working
+     */
+    bool IsReloading() const {
+        return isBuilding.load();
+    }
+
+    /*
+     * WaitForReload
+     *  Waits for the background reload, if any, to finish
+     *
+     * @return ReloadSummary - outcome of the last reload (applied is false if it failed)
+     */
+    ReloadSummary WaitForReload() {
+        if (builder.joinable())
+            builder.join();
+        return lastSummary;
+    }
+};
+
+
+/* *****************************
+ * CatalogValidator Class
+ ***************************** */
+
+// Kinds of problem found by CatalogValidator
+enum class IssueType {
+    Malformed,           // a line that is not "number,name[,prerequisite...]"
+    DuplicateId,         // a course number defined on more than one line
+    MissingPrerequisite, // a prerequisite that is not a course in the file
+    SelfReference,       // a course listed as its own prerequisite
+    Cycle                // courses that are, through their prerequisites, prerequisites of themselves
+};
+
+// One problem found by CatalogValidator
+struct ValidationIssue {
+    IssueType type;      // kind of problem
+    size_t line;         // source line number, starting at 1
+    string courseNumber; // course the problem belongs to (empty for malformed lines)
+    string detail;       // the bad line, the other course number, or the cycle path
+};
+
+// Checks a whole course file in one parallel sweep and reports every problem, not just the first
+class CatalogValidator {
+public:
+    static const size_t ISSUE_TYPES = 5; // number of IssueType values
+
+    // Outcome of one validation
+    struct Report {
+        size_t lineCount = 0;                   // lines in the file
+        size_t courseCount = 0;                 // lines that parsed into courses
+        unsigned threads = 1;                   // threads used
+        double seconds = 0.0;                   // wall time of the whole validation
+        size_t counts[ISSUE_TYPES] = {};        // issues of each type
+        vector<ValidationIssue> issues;         // every issue, in line order
+
+        bool IsValid() const { return issues.empty(); }
+    };
+
+private:
+    /*
+     * WriteJsonString
+     *  Appends text as a quoted JSON string, escaping quotes, backslashes and control characters
+     *
+     * @param string_view text - text to quote
+     * @param ostream& output - stream to write to
+     */
+    static void WriteJsonString(string_view text, ostream& output) {
+        output << '"';
+        for (char character : text) {
+            unsigned char code = static_cast<unsigned char>(character);
+            if (character == '"' || character == '\\') {
+                output << '\\' << character;
+            }
+            else if (code < 0x20) {
+                const char* hex = "0123456789abcdef";
+                output << "\\u00" << hex[code >> 4] << hex[code & 0xF];
+            }
+            else {
+                output << character;
+            }
+        }
+        output << '"';
+    }
+
+public:
+    /*
+     * TypeName
+     *  Name of an issue type as used in the JSON report
+     *
+     * @param IssueType type - issue type
+     *
+     * @return const char* - snake_case name
+     */
+    static const char* TypeName(IssueType type) {
+        static const char* NAMES[ISSUE_TYPES] = { "malformed", "duplicate_id", "missing_prerequisite", "self_reference", "cycle" };
+        return NAMES[static_cast<size_t>(type)];
+    }
+
+    /*
+     * Validate
+     *  Checks every line of a course file
+     *
+     * Lines are parsed in parallel without stopping at bad ones, the course numbers
+     * are indexed once, prerequisites are resolved in parallel through the prerequisite
+     * graph, and a topological sort finds the courses caught in cycles. The catalog
+     * being served is not touched.
+     *
+     * @param const char* data - first byte of the file contents
+     * @param size_t size - number of bytes in the buffer
+     * @param unsigned threadCount - number of threads (0 uses all cores)
+     *
+     * @return Report - every issue found, with counts and timing
+     */
+    static Report Validate(const char* data, size_t size, unsigned threadCount) {
+        auto started = chrono::steady_clock::now();
+        Report report;
+        report.threads = Utils::ResolveThreadCount(threadCount);
+
+        vector<Course> courses;
+        vector<size_t> lines;
+        vector<ParseError> errors;
+        StringArena text;
+        report.lineCount = Vector::ParseBufferKeepingGoing(data, size, threadCount, courses, lines, errors, text);
+        report.courseCount = courses.size();
+        for (ParseError& error : errors)
+            report.issues.push_back(ValidationIssue{ IssueType::Malformed, error.line, string(), move(error.text) });
+
+        // The first line defining a course number wins; later ones are duplicates
+        CourseHashIndex index;
+        index.Reserve(courses.size());
+        for (size_t i = 0; i < courses.size(); i++) {
+            if (!index.Insert(courses, i)) {
+                size_t original = index.Find(courses, courses[i].courseNumber);
+                report.issues.push_back(ValidationIssue{ IssueType::DuplicateId, lines[i], string(courses[i].courseNumber),
+                                                         "first defined on line " + to_string(lines[original]) });
+            }
+        }
+
+        PrerequisiteGraph graph;
+        graph.Build(courses, index, threadCount);
+        for (const PrerequisiteGraph::UnresolvedPrerequisite& missing : graph.GetUnresolved()) {
+            report.issues.push_back(ValidationIssue{ IssueType::MissingPrerequisite, lines[missing.course],
+                                                     string(courses[missing.course].courseNumber), string(missing.prerequisite) });
+        }
+        for (size_t i = 0; i < courses.size(); i++) {
+            const Course& course = courses[i];
+            if (find(course.prerequisites.begin(), course.prerequisites.end(), course.courseNumber) != course.prerequisites.end())
+                report.issues.push_back(ValidationIssue{ IssueType::SelfReference, lines[i], string(course.courseNumber), string(course.courseNumber) });
+        }
+
+        // Self-references are one-course cycles, already reported above
+        PrerequisiteAnalysis analysis;
+        analysis.Analyze(graph);
+        for (const vector<uint32_t>& cycle : analysis.GetCycles()) {
+            if (cycle.size() < 2)
+                continue;
+            string path;
+            for (uint32_t course : cycle)
+                path.append(courses[course].courseNumber).append(" -> ");
+            path.append(courses[cycle.front()].courseNumber);
+            report.issues.push_back(ValidationIssue{ IssueType::Cycle, lines[cycle.front()], string(courses[cycle.front()].courseNumber), path });
+        }
+
+        stable_sort(report.issues.begin(), report.issues.end(), [](const ValidationIssue& a, const ValidationIssue& b) {
+            return a.line < b.line;
+        });
+        for (const ValidationIssue& issue : report.issues)
+            report.counts[static_cast<size_t>(issue.type)]++;
+        report.seconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+        return report;
+    }
+
+    /*
+     * WriteJson
+     *  Writes a report as JSON
+     *
+     * @param const Report& report - validation outcome
+     * @param const string& source - name of the validated file
+     * @param ostream& output - stream to write to
+     */
+    static void WriteJson(const Report& report, const string& source, ostream& output) {
+        output << "{\n  \"source\": ";
+        WriteJsonString(source, output);
+        output << ",\n";
+        output << "  \"lines\": " << report.lineCount << ",\n";
+        output << "  \"courses\": " << report.courseCount << ",\n";
+        output << "  \"threads\": " << report.threads << ",\n";
+        output << "  \"seconds\": " << report.seconds << ",\n";
+        output << "  \"valid\": " << (report.IsValid() ? "true" : "false") << ",\n";
+        output << "  \"counts\": {";
+        for (size_t type = 0; type < ISSUE_TYPES; type++)
+            output << (type > 0 ? ", " : "") << '"' << TypeName(static_cast<IssueType>(type)) << "\": " << report.counts[type];
+        output << "},\n";
+        output << "  \"issues\": [";
+        for (size_t i = 0; i < report.issues.size(); i++) {
+            const ValidationIssue& issue = report.issues[i];
+            output << (i > 0 ? ",\n" : "\n") << "    {\"type\": \"" << TypeName(issue.type) << "\", \"line\": " << issue.line << ", \"course\": ";
+            WriteJsonString(issue.courseNumber, output);
+            output << ", \"detail\": ";
+            WriteJsonString(issue.detail, output);
+            output << "}";
+        }
+        output << (report.issues.empty() ? "]\n}\n" : "\n  ]\n}\n");
+    }
+
+    /*
+     * PrintSummary
+     *  Prints the issue counts and the first few issues, for the menu
+     *
+     * @param const Report& report - validation outcome
+     * @param size_t maxIssues - most issues to list
+     */
+    static void PrintSummary(const Report& report, size_t maxIssues) {
+        cout << "Validation: " << report.counts[0] << " malformed line(s), " << report.counts[1] << " duplicate ID(s), "
+             << report.counts[2] << " missing prerequisite(s), " << report.counts[3] << " self-reference(s), "
+             << report.counts[4] << " cycle(s)." << endl;
+        for (size_t i = 0; i < report.issues.size() && i < maxIssues; i++) {
+            const ValidationIssue& issue = report.issues[i];
+            cout << "   Line " << issue.line << ": " << TypeName(issue.type);
+            if (!issue.courseNumber.empty())
+                cout << " " << issue.courseNumber;
+            cout << " (" << issue.detail << ")" << endl;
+        }
+        if (report.issues.size() > maxIssues)
+            cout << "   ... " << report.issues.size() - maxIssues << " more (run with --validate for the full report)" << endl;
+    }
+};
+
+
+/* *****************************
+ * CompactCatalog Class
+ ***************************** */
+
+// Struct-of-arrays course storage: packed keys, one name pool and a flat prerequisite index array.
+// The arrays live either in vectors owned by the catalog or in a memory-mapped snapshot file.
+class CompactCatalog {
+private:
+    static const uint32_t MISSING = UINT32_MAX;           // prerequisite index used for a course that is not in the catalog
+    static const uint32_t SNAPSHOT_VERSION = 1;           // bumped whenever the snapshot layout changes
+    static const uint32_t SNAPSHOT_BYTE_ORDER = 0x01020304; // read back differently on a machine with another byte order
+    inline static SearchLayout searchLayout = SearchLayout::BTree; // layout of keyIndex, shared by all instances
+
+    // Fixed-size header at the start of a snapshot file, followed by the arrays in declaration order
+    struct SnapshotHeader {
+        char magic[8];           // "ABCUSNAP"
+        uint32_t version;        // SNAPSHOT_VERSION
+        uint32_t byteOrder;      // SNAPSHOT_BYTE_ORDER
+        uint64_t sourceSize;     // size of the CSV the snapshot was built from
+        int64_t sourceModified;  // modification time of that CSV
+        uint64_t courseCount;    // number of courses
+        uint64_t edgeCount;      // number of prerequisite index entries
+        uint64_t namePoolBytes;  // size of the name pool
+        uint64_t checksum;       // Utils::Checksum of everything after the header
+    };
+
+    size_t courseCount;                 // number of courses
+    size_t edgeCount;                   // number of entries in prerequisiteIndex
+    const uint64_t* keys;               // packed course numbers, sorted ascending
+    const uint32_t* nameOffsets;        // course i's name is namePool[nameOffsets[i], nameOffsets[i + 1])
+    const char* namePool;               // every course name, back to back
+    const uint32_t* prerequisiteStart;  // course i's prerequisites are prerequisiteIndex[prerequisiteStart[i], prerequisiteStart[i + 1])
+    const uint32_t* prerequisiteIndex;  // position of each prerequisite in keys, or MISSING
+    KeySearchIndex keyIndex;            // search index over keys, in searchLayout order
+
+    // Storage behind the arrays when built in memory
+    vector<uint64_t> ownedKeys;
+    vector<uint32_t> ownedNameOffsets;
+    string ownedNamePool;
+    vector<uint32_t> ownedPrerequisiteStart;
+    vector<uint32_t> ownedPrerequisiteIndex;
+
+    // Storage behind the arrays when loaded from a snapshot
+    unique_ptr<MappedFile> snapshotFile;
+
+    /*
+     * PointAtOwnedStorage
+     *  Points the array views at the catalog's own vectors
+     */
+    void PointAtOwnedStorage() {
+        courseCount = ownedKeys.size();
+        edgeCount = ownedPrerequisiteIndex.size();
+        keys = ownedKeys.data();
+        nameOffsets = ownedNameOffsets.data();
+        namePool = ownedNamePool.data();
+        prerequisiteStart = ownedPrerequisiteStart.data();
+        prerequisiteIndex = ownedPrerequisiteIndex.data();
+    }
+
+    /*
+     * PaddedSize
+     *  Rounds a section size up so the next section starts 8-byte aligned
+     *
+     * @param size_t bytes - section size
+     *
+     * @return size_t - padded size
+     */
+    static size_t PaddedSize(size_t bytes) {
+        return (bytes + 7) & ~static_cast<size_t>(7);
+    }
+
+    /*
+     * PayloadSize
+     *  Bytes of array data following the header for the given counts
+     *
+     * @param uint64_t courses - course count
+     * @param uint64_t edges - prerequisite index count
+     * @param uint64_t nameBytes - name pool size
+     *
+     * @return uint64_t - payload size
+     */
+    static uint64_t PayloadSize(uint64_t courses, uint64_t edges, uint64_t nameBytes) {
+        return PaddedSize(courses * sizeof(uint64_t))
+            + 2 * PaddedSize((courses + 1) * sizeof(uint32_t))
+            + PaddedSize(edges * sizeof(uint32_t))
+            + PaddedSize(nameBytes);
+    }
+
+    /*
+     * HasConsistentArrays
+     *  Checks, in one pass, that the array views only refer to data inside their own arrays
+     *
+     * The checksum only proves that a snapshot was not damaged after it was written, so
+     * a snapshot is also checked before its offsets are trusted: keys in ascending order,
+     * name and prerequisite offsets never decreasing and within their arrays, and every
+     * prerequisite index a course position or MISSING.
+     *
+     * @param size_t namePoolBytes - size of the name pool
+     *
+     * @return bool - true if every offset and index is in range and the keys are sorted
+     */
+    bool HasConsistentArrays(size_t namePoolBytes) const {
+        if (nameOffsets[courseCount] > namePoolBytes || prerequisiteStart[courseCount] > edgeCount)
+            return false;
+        for (size_t i = 0; i < courseCount; i++) {
+            if (nameOffsets[i] > nameOffsets[i + 1] || prerequisiteStart[i] > prerequisiteStart[i + 1])
+                return false;
+            if (i > 0 && keys[i - 1] > keys[i]) // equal keys are allowed, Build keeps duplicate course numbers
+                return false;
+        }
+        for (size_t e = 0; e < edgeCount; e++) {
+            if (prerequisiteIndex[e] >= courseCount && prerequisiteIndex[e] != MISSING)
+                return false;
+        }
+        return true;
+    }
+
+    /*
+     * Locate
+     *  Search without counting, used while resolving the catalog's own prerequisites
+     *
+     * @param string_view courseNumber - the course number to search for
+     *
+     * @return size_t - position of the course, or SIZE_MAX if not found
+     */
+    size_t Locate(string_view courseNumber) const {
+        uint64_t key;
+        if (!CourseKey::Pack(courseNumber, key))
+            return SIZE_MAX;
+
+        return keyIndex.Find(key);
+    }
+public:
+    /*
+     * CompactCatalog
+     *  Class constructor, creates an empty catalog
+     */
+    CompactCatalog() {
+        Clear();
+    }
+
+    CompactCatalog(const CompactCatalog&) = delete;
+    CompactCatalog& operator=(const CompactCatalog&) = delete;
+
+    /*
+     * Build
+     *  Replaces the catalog with a packed copy of the supplied courses
+     *
+     * Courses are ordered by sorting (key, position) pairs, so the sort compares
+     * integers only. Prerequisites are then resolved once to positions in the key array.
+     *
+     * @param const vector<Course>& courses - courses to pack, in any order
+     *
+     * @return bool - true if every course number fits in a packed key; otherwise false and the catalog is left empty
+     */
+    bool Build(const vector<Course>& courses) {
+        Clear();
+
+        vector<pair<uint64_t, uint32_t>> order(courses.size());
+        for (size_t i = 0; i < courses.size(); i++) {
+            if (!CourseKey::Pack(courses[i].courseNumber, order[i].first))
+                return false;
+            order[i].second = static_cast<uint32_t>(i);
+        }
+        sort(order.begin(), order.end());
+
+        size_t nameBytes = 0;
+        size_t prerequisiteCount = 0;
+        for (const Course& course : courses) {
+            nameBytes += course.name.size();
+            prerequisiteCount += course.prerequisites.size();
+        }
+
+        ownedKeys.reserve(order.size());
+        ownedNameOffsets.reserve(order.size() + 1);
+        ownedNamePool.reserve(nameBytes);
+        ownedPrerequisiteStart.reserve(order.size() + 1);
+        ownedPrerequisiteIndex.reserve(prerequisiteCount);
+
+        for (const pair<uint64_t, uint32_t>& entry : order) {
+            ownedKeys.push_back(entry.first);
+            ownedNameOffsets.push_back(static_cast<uint32_t>(ownedNamePool.size()));
+            ownedNamePool += courses[entry.second].name;
+        }
+        ownedNameOffsets.push_back(static_cast<uint32_t>(ownedNamePool.size()));
+        PointAtOwnedStorage(); // Search below needs the finished key array
+        keyIndex.Build(keys, courseCount, searchLayout);
+
+        // Resolve prerequisites against the finished key array
+        for (const pair<uint64_t, uint32_t>& entry : order) {
+            ownedPrerequisiteStart.push_back(static_cast<uint32_t>(ownedPrerequisiteIndex.size()));
+            for (string_view prerequisite : courses[entry.second].prerequisites) {
+                size_t position = Locate(prerequisite);
+                ownedPrerequisiteIndex.push_back((position == SIZE_MAX) ? MISSING : static_cast<uint32_t>(position));
+            }
+        }
+        ownedPrerequisiteStart.push_back(static_cast<uint32_t>(ownedPrerequisiteIndex.size()));
+
+        PointAtOwnedStorage();
+        Metrics::Set(Metrics::Gauge::CatalogCourses, Size());
+        Metrics::Set(Metrics::Gauge::CatalogBytes, MemoryFootprint());
+        return true;
+    }
+
+    /*
+     * WriteSnapshot
+     *  Saves the catalog as a versioned, checksummed binary snapshot
+     *
+     * The file is written under a temporary name and then renamed, so a reader never
+     * sees a partly written snapshot. The CSV's size and modification time are
+     * recorded so a stale snapshot can be detected later.
+     *
+     * @param const string& snapshotPath - path of the snapshot file to write
+     * @param uint64_t sourceSize - size of the CSV the catalog was loaded from
+     * @param int64_t sourceModified - modification time of that CSV
+     *
+     * @return bool - true if the snapshot was written; otherwise false
+     */
+    bool WriteSnapshot(const string& snapshotPath, uint64_t sourceSize, int64_t sourceModified) const {
+        size_t nameBytes = (courseCount == 0) ? 0 : nameOffsets[courseCount];
+        string payload;
+        payload.reserve(static_cast<size_t>(PayloadSize(courseCount, edgeCount, nameBytes)));
+        auto appendSection = [&payload](const void* data, size_t bytes) {
+            if (bytes > 0)
+                payload.append(static_cast<const char*>(data), bytes);
+            payload.append(PaddedSize(bytes) - bytes, '\0');
+        };
+
+        vector<uint32_t> emptyOffsets(1, 0); // offset arrays for an empty catalog
+        appendSection(keys, courseCount * sizeof(uint64_t));
+        appendSection(courseCount ? nameOffsets : emptyOffsets.data(), (courseCount + 1) * sizeof(uint32_t));
+        appendSection(courseCount ? prerequisiteStart : emptyOffsets.data(), (courseCount + 1) * sizeof(uint32_t));
+        appendSection(prerequisiteIndex, edgeCount * sizeof(uint32_t));
+        appendSection(namePool, nameBytes);
+
+        SnapshotHeader header = {};
+        memcpy(header.magic, "ABCUSNAP", sizeof(header.magic));
+        header.version = SNAPSHOT_VERSION;
+        header.byteOrder = SNAPSHOT_BYTE_ORDER;
+        header.sourceSize = sourceSize;
+        header.sourceModified = sourceModified;
+        header.courseCount = courseCount;
+        header.edgeCount = edgeCount;
+        header.namePoolBytes = nameBytes;
+        header.checksum = Utils::Checksum(payload.data(), payload.size());
+
+        string temporaryPath = snapshotPath + ".tmp";
+        {
+            ofstream file(temporaryPath, ios::binary | ios::trunc);
+            if (!file.is_open())
+                return false;
+            file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            file.write(payload.data(), static_cast<streamsize>(payload.size()));
+            if (!file.good())
+                return false;
+        }
+
+        error_code error;
+        filesystem::rename(temporaryPath, snapshotPath, error);
+        if (error) {
+            filesystem::remove(temporaryPath, error);
+            return false;
+        }
+        return true;
+    }
+
+    /*
+     * LoadSnapshot
+     *  Maps a snapshot file read-only and serves the catalog straight from it
+     *
+     * Nothing is parsed or sorted: after the header and checksum are verified, the array
+     * views simply point into the mapped file, and one pass checks that their offsets
+     * stay in range. Only the search index is built in memory, and not even that for the
+     * Binary layout.
+     *
+     * @param const string& snapshotPath - path of the snapshot file
+     * @param uint64_t sourceSize - current size of the CSV
+     * @param int64_t sourceModified - current modification time of the CSV
+     *
+     * @return bool - true if a fresh, intact snapshot was loaded; otherwise false and the catalog is left empty
+     */
+    bool LoadSnapshot(const string& snapshotPath, uint64_t sourceSize, int64_t sourceModified) {
+        uint64_t started = Metrics::Now();
+        Clear();
+
+        unique_ptr<MappedFile> file;
+        try {
+            file.reset(new MappedFile(snapshotPath));
+        }
+        catch (const exception&) {
+            return false; // no snapshot yet
+        }
+
+        if (file->Size() < sizeof(SnapshotHeader))
+            return false;
+        SnapshotHeader header;
+        memcpy(&header, file->Data(), sizeof(header));
+        if (memcmp(header.magic, "ABCUSNAP", sizeof(header.magic)) != 0
+            || header.version != SNAPSHOT_VERSION
+            || header.byteOrder != SNAPSHOT_BYTE_ORDER
+            || header.sourceSize != sourceSize
+            || header.sourceModified != sourceModified)
+            return false;
+
+        // Positions and offsets are 32-bit, and no section can be larger than the file, which
+        // also keeps the size computation below from overflowing
+        if (header.courseCount >= MISSING || header.courseCount > file->Size()
+            || header.edgeCount >= MISSING || header.edgeCount > file->Size()
+            || header.namePoolBytes > UINT32_MAX || header.namePoolBytes > file->Size())
+            return false;
+
+        uint64_t payloadSize = PayloadSize(header.courseCount, header.edgeCount, header.namePoolBytes);
+        if (file->Size() != sizeof(SnapshotHeader) + payloadSize)
+            return false;
+        const char* payload = file->Data() + sizeof(SnapshotHeader);
+        if (Utils::Checksum(payload, static_cast<size_t>(payloadSize)) != header.checksum)
+            return false;
+
+        courseCount = static_cast<size_t>(header.courseCount);
+        edgeCount = static_cast<size_t>(header.edgeCount);
+        const char* section = payload;
+        keys = reinterpret_cast<const uint64_t*>(section);
+        section += PaddedSize(courseCount * sizeof(uint64_t));
+        nameOffsets = reinterpret_cast<const uint32_t*>(section);
+        section += PaddedSize((courseCount + 1) * sizeof(uint32_t));
+        prerequisiteStart = reinterpret_cast<const uint32_t*>(section);
+        section += PaddedSize((courseCount + 1) * sizeof(uint32_t));
+        prerequisiteIndex = reinterpret_cast<const uint32_t*>(section);
+        section += PaddedSize(edgeCount * sizeof(uint32_t));
+        namePool = section;
+        if (!HasConsistentArrays(static_cast<size_t>(header.namePoolBytes))) {
+            Clear();
+            return false;
+        }
+        snapshotFile = move(file);
+        keyIndex.Build(keys, courseCount, searchLayout);
+        Metrics::Record(Metrics::Timing::Load, Metrics::Now() - started); // only a snapshot that is used counts as a load
+        Metrics::Set(Metrics::Gauge::CatalogCourses, courseCount);
+        Metrics::Set(Metrics::Gauge::CatalogBytes, MemoryFootprint());
+        return true;
+    }
+
+    /*
+     * IsSnapshot
+     *  Indicates whether the catalog is being served from a mapped snapshot file
+     *
+     * @return bool - true if loaded by LoadSnapshot
+     */
+    bool IsSnapshot() const {
+        return snapshotFile != nullptr;
+    }
+
+    /*
+     * Clear
+     *  Removes every course and releases the storage
+     */
+    void Clear() {
+        vector<uint64_t>().swap(ownedKeys);
+        vector<uint32_t>().swap(ownedNameOffsets);
+        string().swap(ownedNamePool);
+        vector<uint32_t>().swap(ownedPrerequisiteStart);
+        vector<uint32_t>().swap(ownedPrerequisiteIndex);
+        snapshotFile.reset();
+        keyIndex.Clear();
+        PointAtOwnedStorage();
+    }
+
+    /*
+     * IsEmpty
+     *  Indicates whether any courses are stored
+     *
+     * @return bool - true if no courses are stored; otherwise false
+     */
+    bool IsEmpty() const {
+        return courseCount == 0;
+    }
+
+    /*
+     * Size
+     *  Number of stored courses
+     *
+     * @return size_t - course count
+     */
+    size_t Size() const {
+        return courseCount;
+    }
+
+    /*
+     * GetCourseNumber
+     *  Course number of the course at a position
+     *
+     * @param size_t position - position of the course
+     *
+     * @return string - decoded course number
+     */
+    string GetCourseNumber(size_t position) const {
+        return CourseKey::Unpack(keys[position]);
+    }
+
+    /*
+     * GetName
+     *  Name of the course at a position, viewed in place in the name pool
+     *
+     * @param size_t position - position of the course
+     *
+     * @return string_view - the course name
+     */
+    string_view GetName(size_t position) const {
+        return string_view(namePool + nameOffsets[position], nameOffsets[position + 1] - nameOffsets[position]);
+    }
+
+    /*
+     * Search
+     *  Looks up a course number in the packed key array through the search index
+     *
+     * @param string_view courseNumber - the course number to search for
+     *
+     * @return size_t - position of the course, or SIZE_MAX if not found
+     */
+    size_t Search(string_view courseNumber) const {
+        Metrics::Increment(Metrics::Counter::Searches);
+        size_t position = Locate(courseNumber);
+        if (position == SIZE_MAX)
+            Metrics::Increment(Metrics::Counter::SearchMisses);
+        return position;
+    }
+
+    /*
+     * SetSearchLayout
+     *  Selects the search index layout for catalogs built or loaded from now on
+     *
+     * @param SearchLayout layout - Binary, Eytzinger or BTree
+     */
+    static void SetSearchLayout(SearchLayout layout) {
+        searchLayout = layout;
+    }
+
+    /*
+     * GetSearchLayout
+     *  Returns the search index layout in use
+     *
+     * @return SearchLayout - Binary, Eytzinger or BTree
+     */
+    static SearchLayout GetSearchLayout() {
+        return searchLayout;
+    }
+
+    /*
+     * FindMissingPrerequisites
+     *  Scans the flat prerequisite array for prerequisites that did not resolve
+     *
+     * @return size_t - position of the first course with a missing prerequisite, or SIZE_MAX if all are valid
+     */
+    size_t FindMissingPrerequisites() const {
+        for (size_t i = 0; i < courseCount; i++) {
+            for (uint32_t p = prerequisiteStart[i]; p < prerequisiteStart[i + 1]; p++) {
+                if (prerequisiteIndex[p] == MISSING)
+                    return i;
+            }
+        }
+        return SIZE_MAX;
+    }
+
+    /*
+     * PrintCourse
+     *  Prints a single course's information, in the same format as Vector::PrintCourse
+     *
+     * @param size_t position - position of the course to print
+     * @param bool includePrerequisites - whether to include prerequisite information
+     */
+    void PrintCourse(size_t position, bool includePrerequisites = false) const {
+        if (position >= courseCount)
+            return;
+
+        cout << GetCourseNumber(position) << ", " << GetName(position);
+        if (includePrerequisites) {
+            string prerequisiteInfo;
+            for (uint32_t p = prerequisiteStart[position]; p < prerequisiteStart[position + 1]; p++) {
+                if (prerequisiteIndex[p] == MISSING)
+                    continue;
+                uint32_t prerequisite = prerequisiteIndex[p];
+                prerequisiteInfo += GetCourseNumber(prerequisite) + ", " + string(GetName(prerequisite)) + "; ";
+            }
+
+            if (!prerequisiteInfo.empty())
+                prerequisiteInfo = prerequisiteInfo.substr(0, prerequisiteInfo.length() - 2);
+            else if (prerequisiteStart[position] == prerequisiteStart[position + 1])
+                prerequisiteInfo = "None";
+            else
+                prerequisiteInfo = "Error: Prerequisites expected, but none found";
+            cout << "\nPrerequisites: " << prerequisiteInfo;
+        }
+        cout << endl;
+    }
+
+    /*
+     * PrintAllCourses
+     *  Prints all stored courses in sorted order, without prerequisite details
+     */
+    void PrintAllCourses() const {
+        for (size_t i = 0; i < courseCount; i++) {
+            PrintCourse(i);
+        }
+    }
+
+    /*
+     * MemoryFootprint
+     *  Bytes held by the catalog arrays and search index (a mapped snapshot counts as its file size)
+     *
+     * @return size_t - allocated or mapped bytes
+     */
+    size_t MemoryFootprint() const {
+        if (snapshotFile)
+            return snapshotFile->Size() + keyIndex.MemoryFootprint();
+        return keyIndex.MemoryFootprint()
+            + ownedKeys.capacity() * sizeof(uint64_t)
+            + ownedNameOffsets.capacity() * sizeof(uint32_t)
+            + ownedNamePool.capacity()
+            + ownedPrerequisiteStart.capacity() * sizeof(uint32_t)
+            + ownedPrerequisiteIndex.capacity() * sizeof(uint32_t);
+    }
+};
+
+
+/* *****************************
+ * OutputBuffer Class
+ ***************************** */
+
+// Collects output text in one large reusable buffer and writes it to a stream in bulk
+class OutputBuffer {
+private:
+    FILE* stream;          // destination stream
+    string buffer;         // pending text, its capacity is reused after every write
+    size_t flushThreshold; // write once the pending text reaches this many bytes
+
+public:
+    /*
+     * OutputBuffer
+     *  Class constructor
+     *
+     * @param FILE* outputStream - stream to write to, such as stdout
+     * @param size_t capacity = 1 MB - buffer size, and the size of each write
+     */
+    explicit OutputBuffer(FILE* outputStream, size_t capacity = 1 << 20) : stream(outputStream), flushThreshold(capacity) {
+        buffer.reserve(capacity + capacity / 4);
+    }
+
+    OutputBuffer(const OutputBuffer&) = delete;
+    OutputBuffer& operator=(const OutputBuffer&) = delete;
+
+    /*
+     * ~OutputBuffer
+     *  Class destructor, writes any pending text
+     */
+    ~OutputBuffer() {
+        Flush();
+    }
+
+    /*
+     * Text
+     *  Direct access to the pending text, so formatters can append in place
+     *
+     * @return string& - the buffer
+     */
+    string& Text() {
+        return buffer;
+    }
+
+    /*
+     * Append
+     *  Adds text, writing the buffer out first if it is full
+     *
+     * @param string_view text - text to add
+     */
+    void Append(string_view text) {
+        buffer.append(text.data(), text.size());
+        FlushIfFull();
+    }
+
+    /*
+     * FlushIfFull
+     *  Writes the pending text once it has reached the threshold
+     */
+    void FlushIfFull() {
+        if (buffer.size() >= flushThreshold)
+            Flush();
+    }
+
+    /*
+     * Flush
+     *  Writes all pending text and empties the buffer, keeping its capacity
+     */
+    void Flush() {
+        if (!buffer.empty())
+            fwrite(buffer.data(), 1, buffer.size(), stream);
+        buffer.clear();
+        fflush(stream);
+    }
+};
+
+
+/* *****************************
+ * ShardedCatalog Class
+ ***************************** */
+
+// A catalog spread over one file per department, each loaded into its own sorted, indexed Vector
+//
+// Shards are keyed by the letters at the start of their course numbers (CSCI, MATH, ...)
+// and a router sends every lookup to the one shard that can hold the course. Each shard
+// resolves its own prerequisites in its prerequisite graph. A prerequisite from another
+// department is resolved through the router by course number when it is read, so
+// replacing one shard never invalidates links held by the others.
+class ShardedCatalog {
+private:
+    // One department's courses and the file they came from
+    struct Shard {
+        string department;         // course number prefix shared by every course in the shard
+        string filePath;           // file the shard was loaded from
+        uint64_t fileSize = 0;     // size of the file when it was loaded
+        int64_t fileModified = 0;  // modification time of the file when it was loaded
+        unique_ptr<Vector> courses; // finalized courses; held by pointer so Course addresses survive shard moves
+    };
+
+    vector<Shard> shards; // sorted by department
+
+    /*
+     * DepartmentOf
+     *  The letters at the start of a course number, e.g. "CSCI" for "CSCI300"
+     *
+     * @param string_view courseNumber - trimmed, uppercase course number
+     *
+     * @return string_view - the department prefix (empty if the number starts with a digit)
+     */
+    static string_view DepartmentOf(string_view courseNumber) {
+        size_t length = 0;
+        while (length < courseNumber.size() && isalpha(static_cast<unsigned char>(courseNumber[length])))
+            length++;
+        return courseNumber.substr(0, length);
+    }
+
+    /*
+     * LoadShard
+     *  Loads and finalizes one department file
+     *
+     * @param const string& filePath - department file to load
+     *
+     * @return Shard - the loaded shard
+     *
+     * @exception runtime_error is thrown if the file cannot be read or parsed, is empty or holds more than one department
+     */
+    static Shard LoadShard(const string& filePath) {
+        Shard shard;
+        shard.filePath = filePath;
+        Utils::GetFileStamp(filePath, shard.fileSize, shard.fileModified);
+        MappedFile file(filePath);
+        shard.courses.reset(new Vector());
+        // A shard cut off at a bad line would silently drop the rest of the department
+        if (!shard.courses->ReadCoursesFromMappedFile(file))
+            throw runtime_error("ERROR: " + filePath + " has a line that could not be parsed");
+        shard.courses->Finalize();
+
+        const vector<Course>& courses = shard.courses->GetCourses();
+        if (courses.empty())
+            throw runtime_error("ERROR: No courses in " + filePath);
+        string_view department = DepartmentOf(courses.front().courseNumber);
+        for (const Course& course : courses) {
+            if (DepartmentOf(course.courseNumber) != department) {
+                throw runtime_error("ERROR: " + filePath + " mixes departments " + string(department)
+                                    + " and " + string(DepartmentOf(course.courseNumber)));
+            }
+        }
+        shard.department.assign(department.data(), department.size());
+        return shard;
+    }
+
+    /*
+     * Route
+     *  Finds the shard that holds a department
+     *
+     * @param string_view department - department prefix
+     *
+     * @return size_t - shard position, or SIZE_MAX if no shard holds the department
+     */
+    size_t Route(string_view department) const {
+        auto shard = lower_bound(shards.begin(), shards.end(), department, [](const Shard& entry, string_view value) {
+            return string_view(entry.department) < value;
+        });
+        if (shard == shards.end() || shard->department != department)
+            return SIZE_MAX;
+        return static_cast<size_t>(shard - shards.begin());
+    }
+
+public:
+    /*
+     * ListCatalogFiles
+     *  Every .csv file in a directory, in name order
+     *
+     * @param const string& directory - directory holding one catalog file per department
+     *
+     * @return vector<string> - paths of the files
+     *
+     * @exception runtime_error is thrown if the directory cannot be read
+     */
+    static vector<string> ListCatalogFiles(const string& directory) {
+        error_code error;
+        vector<string> filePaths;
+        for (const filesystem::directory_entry& entry : filesystem::directory_iterator(directory, error)) {
+            if (entry.is_regular_file() && entry.path().extension() == ".csv")
+                filePaths.push_back(entry.path().string());
+        }
+        if (error)
+            throw runtime_error("ERROR: Could not read directory " + directory);
+        sort(filePaths.begin(), filePaths.end());
+        return filePaths;
+    }
+
+    /*
+     * LoadFiles
+     *  Loads every department file concurrently, one file per task, replacing all shards
+     *
+     * If any file fails, the current shards are kept.
+     *
+     * @param const vector<string>& filePaths - one catalog file per department
+     * @param unsigned threadCount - number of files loaded at once (0 uses all cores)
+     *
+     * @exception runtime_error is thrown if a file cannot be loaded or two files hold the same department
+     */
+    void LoadFiles(const vector<string>& filePaths, unsigned threadCount) {
+        vector<Shard> loaded(filePaths.size());
+        vector<string> errors(filePaths.size());
+        Utils::RunParallel(filePaths.size(), threadCount, [&](size_t i) {
+            try {
+                loaded[i] = LoadShard(filePaths[i]);
+            }
+            catch (const exception& e) {
+                errors[i] = e.what();
+            }
+        });
+        for (const string& error : errors) {
+            if (!error.empty())
+                throw runtime_error(error);
+        }
+
+        sort(loaded.begin(), loaded.end(), [](const Shard& a, const Shard& b) { return a.department < b.department; });
+        for (size_t i = 1; i < loaded.size(); i++) {
+            if (loaded[i].department == loaded[i - 1].department) {
+                throw runtime_error("ERROR: Department " + loaded[i].department + " is in both "
+                                    + loaded[i - 1].filePath + " and " + loaded[i].filePath);
+            }
+        }
+        shards = move(loaded);
+        Metrics::Set(Metrics::Gauge::CatalogCourses, Size());
+        Metrics::Set(Metrics::Gauge::CatalogBytes, MemoryFootprint());
+    }
+
+    /*
+     * ReloadChanged
+     *  Reloads only the department files whose size or modification time changed
+     *
+     * Each changed file is loaded into a fresh shard, which then replaces the old one;
+     * every other shard is left untouched. A file that fails to load, or that now holds
+     * a different department, keeps its old shard.
+     *
+     * @param unsigned threadCount - number of files reloaded at once (0 uses all cores)
+     * @param vector<string>& messages - receives one line per reloaded or failed department
+     *
+     * @return size_t - number of shards replaced
+     */
+    size_t ReloadChanged(unsigned threadCount, vector<string>& messages) {
+        vector<size_t> changed;
+        for (size_t i = 0; i < shards.size(); i++) {
+            uint64_t size = 0;
+            int64_t modified = 0;
+            if (!Utils::GetFileStamp(shards[i].filePath, size, modified) || size != shards[i].fileSize || modified != shards[i].fileModified)
+                changed.push_back(i);
+        }
+
+        vector<Shard> reloaded(changed.size());
+        vector<string> errors(changed.size());
+        Utils::RunParallel(changed.size(), threadCount, [&](size_t i) {
+            try {
+                reloaded[i] = LoadShard(shards[changed[i]].filePath);
+                if (reloaded[i].department != shards[changed[i]].department)
+                    errors[i] = "ERROR: " + reloaded[i].filePath + " now holds department " + reloaded[i].department;
+            }
+            catch (const exception& e) {
+                errors[i] = e.what();
+            }
+        });
+
+        size_t replaced = 0;
+        for (size_t i = 0; i < changed.size(); i++) {
+            Shard& shard = shards[changed[i]];
+            if (!errors[i].empty()) {
+                messages.push_back(errors[i] + "; kept the current " + shard.department + " courses.");
+                continue;
+            }
+            shard = move(reloaded[i]);
+            messages.push_back("Reloaded " + shard.department + ": " + to_string(shard.courses->GetCourses().size())
+                               + " course(s) from " + shard.filePath + ".");
+            replaced++;
+        }
+        if (replaced > 0) {
+            Metrics::Set(Metrics::Gauge::CatalogCourses, Size());
+            Metrics::Set(Metrics::Gauge::CatalogBytes, MemoryFootprint());
+        }
+        return replaced;
+    }
+
+    /*
+     * Search
+     *  Routes a course number to its department's shard and looks it up there
+     *
+     * @param string_view courseNumber - trimmed, uppercase course number
+     *
+     * @return const Course* - the course, or nullptr if no shard holds it
+     */
+    const Course* Search(string_view courseNumber) const {
+        size_t shard = Route(DepartmentOf(courseNumber));
+        if (shard == SIZE_MAX) {
+            Metrics::Increment(Metrics::Counter::Searches);
+            Metrics::Increment(Metrics::Counter::SearchMisses);
+            return nullptr;
+        }
+        return shards[shard].courses->Search(courseNumber);
+    }
+
+    /*
+     * FormatCourse
+     *  Appends a course in the same format as Vector::FormatCourse, resolving
+     * prerequisites from any department through the router
+     *
+     * @param const Course* course - course to format
+     * @param bool includePrerequisites - true to add the prerequisites line
+     * @param string& output - buffer the text is appended to
+     */
+    void FormatCourse(const Course* course, bool includePrerequisites, string& output) const {
+        output.append(course->courseNumber).append(", ").append(course->name);
+        if (!includePrerequisites)
+            return;
+
+        output.append("\nPrerequisites: ");
+        if (course->prerequisites.empty()) {
+            output.append("None");
+            return;
+        }
+        for (size_t i = 0; i < course->prerequisites.size(); i++) {
+            const Course* prerequisite = Search(course->prerequisites[i]);
+            if (i > 0)
+                output.append("; ");
+            if (prerequisite != nullptr)
+                output.append(prerequisite->courseNumber).append(", ").append(prerequisite->name);
+            else
+                output.append(course->prerequisites[i]).append(", (not found in catalog)");
+        }
+    }
+
+    /*
+     * AllPrerequisites
+     *  Every direct and indirect prerequisite of a course across all departments, nearest first
+     *
+     * @param const Course* course - course to expand
+     * @param vector<string_view>& missing - receives prerequisites that no shard holds
+     *
+     * @return vector<const Course*> - the required courses, in breadth-first order
+     */
+    vector<const Course*> AllPrerequisites(const Course* course, vector<string_view>& missing) const {
+        vector<const Course*> pending{ course };
+        unordered_set<const Course*> seen{ course };
+        for (size_t i = 0; i < pending.size(); i++) {
+            for (string_view number : pending[i]->prerequisites) {
+                const Course* prerequisite = Search(number);
+                if (prerequisite == nullptr)
+                    missing.push_back(number);
+                else if (seen.insert(prerequisite).second)
+                    pending.push_back(prerequisite);
+            }
+        }
+        pending.erase(pending.begin());
+        return pending;
+    }
+
+    /*
+     * CountMissingPrerequisites
+     *  Counts listed prerequisites that no department holds
+     *
+     * Only each shard's unresolved side table needs checking, since its graph has
+     * already resolved every prerequisite from its own department.
+     *
+     * @return size_t - number of missing prerequisite listings
+     */
+    size_t CountMissingPrerequisites() const {
+        size_t missing = 0;
+        for (const Shard& shard : shards) {
+            for (const PrerequisiteGraph::UnresolvedPrerequisite& entry : shard.courses->GetPrerequisiteGraph().GetUnresolved())
+                missing += (Search(entry.prerequisite) == nullptr);
+        }
+        return missing;
+    }
+
+    /*
+     * PrintAllCourses
+     *  Prints every course in course number order
+     *
+     * Shards are sorted by department and each shard is sorted, so printing the shards
+     * in order gives one sorted list.
+     */
+    void PrintAllCourses() const {
+        OutputBuffer output(stdout);
+        for (const Shard& shard : shards) {
+            for (const Course& course : shard.courses->GetCourses()) {
+                FormatCourse(&course, false, output.Text());
+                output.Text().push_back('\n');
+                output.FlushIfFull();
+            }
+        }
+    }
+
+    /*
+     * Departments
+     *  Department prefixes of the loaded shards, in order
+     *
+     * @return vector<string> - one prefix per shard
+     */
+    vector<string> Departments() const {
+        vector<string> departments;
+        for (const Shard& shard : shards)
+            departments.push_back(shard.department);
+        return departments;
+    }
+
+    /*
+     * Size
+     *  Number of courses over all shards
+     *
+     * @return size_t - course count
+     */
+    size_t Size() const {
+        size_t courseCount = 0;
+        for (const Shard& shard : shards)
+            courseCount += shard.courses->GetCourses().size();
+        return courseCount;
+    }
+
+    /*
+     * IsEmpty
+     *  Indicates whether any shard is loaded
+     *
+     * @return bool - true if no department has been loaded
+     */
+    bool IsEmpty() const {
+        return shards.empty();
+    }
+
+    /*
+     * MemoryFootprint
+     *  Bytes held by every shard
+     *
+     * @return size_t - total footprint
+     */
+    size_t MemoryFootprint() const {
+        size_t bytes = shards.capacity() * sizeof(Shard);
+        for (const Shard& shard : shards)
+            bytes += shard.courses->MemoryFootprint();
+        return bytes;
+    }
+};
+
+
+/* *****************************
+ * BatchQuery Class
+ ***************************** */
+
+// Looks up a whole list of course numbers against a loaded, sorted Vector in one pass
+class BatchQuery {
+private:
+    static constexpr size_t NOT_FOUND = SIZE_MAX; // result for a course number not in the catalog
+    static const size_t FORMAT_BLOCK = 4096;    // queries formatted per parallel task
+
+public:
+    /*
+     * ParseQueries
+     *  Splits raw input into one trimmed, uppercase course number per non-blank line
+     *
+     * @param const char* data - first byte of the input
+     * @param size_t size - number of bytes of input
+     *
+     * @return vector<string> - course numbers, in input order
+     */
+    static vector<string> ParseQueries(const char* data, size_t size) {
+        vector<string> queries;
+        const char* position = data;
+        const char* end = data + size;
+        string_view line;
+        while (Utils::NextLine(position, end, line)) {
+            queries.emplace_back();
+            Utils::TrimAndUppercaseInto(line, queries.back());
+        }
+        return queries;
+    }
+
+    /*
+     * Resolve
+     *  Finds every query in the sorted course collection with a sorted merge
+     *
+     * The queries are sorted, then split into one contiguous run per thread. Each run
+     * walks forward through the collection, searching only the part after the previous
+     * match, so the whole batch is a single ordered pass instead of one full search per query.
+     *
+     * @param const vector<Course>& courses - course collection, sorted by course number
+     * @param const vector<string>& queries - course numbers to find
+     * @param unsigned threadCount - number of worker threads (0 uses all cores)
+     *
+     * @return vector<size_t> - position of each query's course, or NOT_FOUND, in query order
+     */
+    static vector<size_t> Resolve(const vector<Course>& courses, const vector<string>& queries, unsigned threadCount) {
+        vector<uint32_t> order(queries.size());
+        for (size_t i = 0; i < order.size(); i++)
+            order[i] = static_cast<uint32_t>(i);
+        sort(order.begin(), order.end(), [&queries](uint32_t a, uint32_t b) { return queries[a] < queries[b]; });
+
+        vector<size_t> results(queries.size(), NOT_FOUND);
+        size_t runCount = min<size_t>(Utils::ResolveThreadCount(threadCount), max<size_t>(order.size(), 1));
+        auto byNumber = [](const Course& course, const string& number) { return course.courseNumber < number; };
+        Utils::RunParallel(runCount, threadCount, [&](size_t run) {
+            size_t first = order.size() * run / runCount;
+            size_t last = order.size() * (run + 1) / runCount;
+            auto cursor = courses.begin();
+            for (size_t i = first; i < last; i++) {
+                const string& number = queries[order[i]];
+                cursor = lower_bound(cursor, courses.end(), number, byNumber);
+                if (cursor != courses.end() && cursor->courseNumber == number)
+                    results[order[i]] = static_cast<size_t>(cursor - courses.begin());
+            }
+        });
+        return results;
+    }
+
+    /*
+     * Run
+     *  Resolves a file of course numbers and writes each course, with prerequisites, in input order
+     *
+     * Results are formatted in blocks. With more than one thread, a wave of blocks is
+     * formatted in parallel into per-block buffers, which are then written in order, so
+     * the output is identical to a single-threaded run.
+     *
+     * @param const Vector& catalog - loaded catalog; must be sorted with a current prerequisite graph
+     * @param const char* data - first byte of the query input
+     * @param size_t size - number of bytes of query input
+     * @param unsigned threadCount - number of worker threads (0 uses all cores)
+     * @param OutputBuffer& output - destination for the results
+     *
+     * @return size_t - number of queries found in the catalog
+     */
+    static size_t Run(const Vector& catalog, const char* data, size_t size, unsigned threadCount, OutputBuffer& output) {
+        const vector<Course>& courses = catalog.GetCourses();
+        vector<string> queries = ParseQueries(data, size);
+        vector<size_t> results = Resolve(courses, queries, threadCount);
+
+        // Formats queries [first, last) into a buffer
+        auto formatBlock = [&](size_t first, size_t last, string& text) {
+            for (size_t i = first; i < last; i++) {
+                if (results[i] == NOT_FOUND)
+                    text.append("Course ").append(queries[i]).append(" not found.");
+                else
+                    catalog.FormatCourse(&courses[results[i]], true, text);
+                text.push_back('\n');
+            }
+        };
+
+        size_t blockCount = (queries.size() + FORMAT_BLOCK - 1) / FORMAT_BLOCK;
+        unsigned threads = Utils::ResolveThreadCount(threadCount);
+        if (threads == 1) {
+            for (size_t block = 0; block < blockCount; block++) {
+                formatBlock(block * FORMAT_BLOCK, min(queries.size(), (block + 1) * FORMAT_BLOCK), output.Text());
+                output.FlushIfFull();
+            }
+        }
+        else {
+            vector<string> blockText(threads);
+            for (size_t wave = 0; wave < blockCount; wave += threads) {
+                size_t waveBlocks = min<size_t>(threads, blockCount - wave);
+                Utils::RunParallel(waveBlocks, threads, [&](size_t b) {
+                    size_t block = wave + b;
+                    blockText[b].clear();
+                    formatBlock(block * FORMAT_BLOCK, min(queries.size(), (block + 1) * FORMAT_BLOCK), blockText[b]);
+                });
+                for (size_t b = 0; b < waveBlocks; b++)
+                    output.Append(blockText[b]);
+            }
+        }
+        output.Flush();
+
+        return static_cast<size_t>(count_if(results.begin(), results.end(), [](size_t result) { return result != NOT_FOUND; }));
+    }
+};
+
+
+/* *****************************
+ * EligibilityEngine Class
+ ***************************** */
+
+// Works out, for whole files of student transcripts, which courses each student may take next
+//
+// A course is eligible when the student has not completed it and has completed every
+// one of its direct prerequisites. Transcripts are packed bitsets over collection
+// positions. Each course's prerequisite set is a packed bitset over the same positions,
+// stored as only its non-zero words, since a dense row per course would cost n^2 / 8 bytes.
+class EligibilityEngine {
+private:
+    static const size_t STUDENT_BLOCK = 1024; // transcripts evaluated by one parallel task
+
+    // Scratch bitsets and buffers owned by one parallel task, reused for every student it evaluates
+    struct Workspace {
+        vector<uint64_t> transcript; // bit i set when the student has completed course i
+        vector<uint64_t> eligible;   // candidate courses found through the student's completed courses
+        vector<uint32_t> completed;  // positions of the set transcript bits, so they can be cleared cheaply
+        string field;                // trimmed, uppercase course number being looked up
+    };
+
+    const Vector& catalog;       // finalized catalog the transcripts refer to
+    size_t wordsPerSet;          // 64-bit words per course bitset
+    vector<uint32_t> ruleStart;  // course i's prerequisite words are ruleWord/ruleMask[ruleStart[i], ruleStart[i + 1])
+    vector<uint32_t> ruleWord;   // word of the transcript a rule tests
+    vector<uint64_t> ruleMask;   // prerequisite bits that must all be set in that word
+    vector<uint64_t> openBits;   // courses without prerequisites, eligible until completed
+    vector<uint64_t> blockedBits; // courses with a prerequisite missing from the catalog, never eligible
+
+    /*
+     * IsReady
+     *  Tests whether every prerequisite of a course is in a transcript
+     *
+     * Each rule contributes the prerequisite bits its word is missing; the course is
+     * ready when nothing is missing. The loop has no data-dependent branches.
+     *
+     * @param uint32_t course - position of the course
+     * @param const uint64_t* transcript - the student's completed courses
+     *
+     * @return bool - true if all prerequisites are completed
+     */
+    bool IsReady(uint32_t course, const uint64_t* transcript) const {
+        uint64_t missing = 0;
+        for (uint32_t r = ruleStart[course]; r < ruleStart[course + 1]; r++)
+            missing |= ruleMask[r] & ~transcript[ruleWord[r]];
+        return missing == 0;
+    }
+
+    /*
+     * EvaluateStudent
+     *  Writes one output line listing the courses a student is eligible for
+     *
+     * Only courses without prerequisites and dependents of completed courses can be
+     * eligible, so the rules are tested just for those dependents. One pass of word-wide
+     * AND/OR over the bitsets then removes completed and blocked courses, and the
+     * remaining bits are listed in course number order.
+     *
+     * @param string_view line - "STUDENT,COURSE,COURSE,..." with the student's completed courses
+     * @param Workspace& work - the calling task's scratch space
+     * @param string& output - receives "STUDENT,COURSE,COURSE,..." with the eligible courses
+     * @param size_t& unknown - incremented for every completed course not in the catalog
+     *
+     * @return size_t - number of eligible courses listed
+     */
+    size_t EvaluateStudent(string_view line, Workspace& work, string& output, size_t& unknown) const {
+        const vector<Course>& courses = catalog.GetCourses();
+        const PrerequisiteGraph& graph = catalog.GetPrerequisiteGraph();
+        uint64_t* transcript = work.transcript.data();
+        uint64_t* eligible = work.eligible.data();
+
+        // The first field names the student, the rest are completed course numbers
+        size_t comma = line.find(',');
+        string_view student = line.substr(0, comma);
+        while (!student.empty() && student.front() == ' ')
+            student.remove_prefix(1);
+        while (!student.empty() && student.back() == ' ')
+            student.remove_suffix(1);
+        while (comma != string_view::npos) {
+            size_t next = line.find(',', comma + 1);
+            Utils::TrimAndUppercaseInto(line.substr(comma + 1, next - comma - 1), work.field);
+            comma = next;
+            if (work.field.empty())
+                continue;
+
+            const Course* course = catalog.Search(work.field);
+            if (course == nullptr) {
+                unknown++;
+                continue;
+            }
+            uint32_t position = static_cast<uint32_t>(course - courses.data());
+            uint64_t bit = uint64_t(1) << (position % 64);
+            if ((transcript[position / 64] & bit) == 0) {
+                transcript[position / 64] |= bit;
+                work.completed.push_back(position);
+            }
+        }
+
+        for (uint32_t completed : work.completed) {
+            for (uint32_t dependent : graph.Dependents(completed)) {
+                uint64_t bit = uint64_t(1) << (dependent % 64);
+                if (((transcript[dependent / 64] | eligible[dependent / 64]) & bit) == 0 && IsReady(dependent, transcript))
+                    eligible[dependent / 64] |= bit;
+            }
+        }
+
+        // Word-wide kernel over the whole catalog, written so the compiler can vectorize it
+        const uint64_t* open = openBits.data();
+        const uint64_t* blocked = blockedBits.data();
+        for (size_t w = 0; w < wordsPerSet; w++)
+            eligible[w] = (eligible[w] | open[w]) & ~(transcript[w] | blocked[w]);
+
+        size_t found = 0;
+        output.append(student.data(), student.size());
+        for (size_t w = 0; w < wordsPerSet; w++) {
+            for (uint64_t bits = eligible[w]; bits != 0; bits &= bits - 1) {
+                const Course& course = courses[w * 64 + Utils::LowestSetBit(bits)];
+                output.push_back(',');
+                output.append(course.courseNumber.data(), course.courseNumber.size());
+                found++;
+            }
+            eligible[w] = 0;
+        }
+        output.push_back('\n');
+
+        for (uint32_t completed : work.completed)
+            transcript[completed / 64] &= ~(uint64_t(1) << (completed % 64));
+        work.completed.clear();
+        return found;
+    }
+
+public:
+    /*
+     * EligibilityEngine
+     *  Class constructor, packs every course's prerequisites into bitset rules
+     *
+     * @param const Vector& finalizedCatalog - loaded catalog; must be finalized (see Vector::Finalize)
+     *                                         and must outlive the engine
+     */
+    explicit EligibilityEngine(const Vector& finalizedCatalog) : catalog(finalizedCatalog) {
+        const PrerequisiteGraph& graph = catalog.GetPrerequisiteGraph();
+        size_t courseCount = catalog.GetCourses().size();
+        wordsPerSet = (courseCount + 63) / 64;
+        openBits.assign(wordsPerSet, 0);
+        blockedBits.assign(wordsPerSet, 0);
+        ruleStart.assign(1, 0);
+        ruleStart.reserve(courseCount + 1);
+
+        vector<uint32_t> prerequisites;
+        for (size_t i = 0; i < courseCount; i++) {
+            PrerequisiteGraph::EdgeList row = graph.Prerequisites(i);
+            if (row.empty())
+                openBits[i / 64] |= uint64_t(1) << (i % 64);
+
+            // Sorted positions share a word when they are adjacent, so each word becomes one rule
+            prerequisites.assign(row.begin(), row.end());
+            sort(prerequisites.begin(), prerequisites.end());
+            for (uint32_t prerequisite : prerequisites) {
+                uint64_t bit = uint64_t(1) << (prerequisite % 64);
+                if (ruleWord.size() > ruleStart.back() && ruleWord.back() == prerequisite / 64) {
+                    ruleMask.back() |= bit;
+                }
+                else {
+                    ruleWord.push_back(prerequisite / 64);
+                    ruleMask.push_back(bit);
+                }
+            }
+            ruleStart.push_back(static_cast<uint32_t>(ruleWord.size()));
+        }
+        for (const PrerequisiteGraph::UnresolvedPrerequisite& missing : graph.GetUnresolved())
+            blockedBits[missing.course / 64] |= uint64_t(1) << (missing.course % 64);
+    }
+
+    /*
+     * Run
+     *  Streams a file of transcripts through the engine and writes one eligibility line per student
+     *
+     * Input lines are "STUDENT,COURSE,COURSE,..." (blank lines are skipped); output lines
+     * have the same form and list the eligible courses in course number order. The input
+     * is taken a wave at a time: a wave holds one block of students per thread, the blocks
+     * are evaluated in parallel into per-block buffers, and the buffers are written in
+     * order, so memory stays bounded and the output matches a single-threaded run.
+     *
+     * @param const char* data - first byte of the transcript input
+     * @param size_t size - number of bytes of transcript input
+     * @param unsigned threadCount - number of worker threads (0 uses all cores)
+     * @param OutputBuffer& output - destination for the results
+     *
+     * @return EligibilitySummary - counts of students, eligible courses and unknown course numbers
+     */
+    EligibilitySummary Run(const char* data, size_t size, unsigned threadCount, OutputBuffer& output) const {
+        EligibilitySummary summary;
+        unsigned threads = Utils::ResolveThreadCount(threadCount);
+        vector<Workspace> workspaces(threads);
+        for (Workspace& work : workspaces) {
+            work.transcript.assign(wordsPerSet, 0);
+            work.eligible.assign(wordsPerSet, 0);
+        }
+        vector<string> blockText(threads);
+        vector<size_t> blockEligible(threads);
+        vector<size_t> blockUnknown(threads);
+        vector<string_view> lines;
+        lines.reserve(threads * STUDENT_BLOCK);
+
+        const char* position = data;
+        const char* end = data + size;
+        while (position < end) {
+            lines.clear();
+            string_view line;
+            while (lines.size() < threads * STUDENT_BLOCK && Utils::NextLine(position, end, line))
+                lines.push_back(line);
+
+            size_t blockCount = (lines.size() + STUDENT_BLOCK - 1) / STUDENT_BLOCK;
+            Utils::RunParallel(blockCount, threads, [&](size_t block) {
+                blockText[block].clear();
+                blockEligible[block] = 0;
+                blockUnknown[block] = 0;
+                size_t last = min(lines.size(), (block + 1) * STUDENT_BLOCK);
+                for (size_t i = block * STUDENT_BLOCK; i < last; i++)
+                    blockEligible[block] += EvaluateStudent(lines[i], workspaces[block], blockText[block], blockUnknown[block]);
+            });
+            for (size_t block = 0; block < blockCount; block++) {
+                output.Append(blockText[block]);
+                summary.eligible += blockEligible[block];
+                summary.unknown += blockUnknown[block];
+            }
+            summary.students += lines.size();
+        }
+        output.Flush();
+        return summary;
+    }
+};
+
+
+/* *****************************
+ * TermPlanner Class
+ ***************************** */
+
+// Plans the terms in which a student can take a set of target courses, at most a fixed number per term
+//
+// The courses to schedule are the targets plus everything they transitively require.
+// Terms are filled by list scheduling: a course becomes ready once all of its
+// prerequisites sit in earlier terms, and each term takes the ready courses with the
+// longest chain of planned courses still depending on them (the critical path). Without
+// a cap this gives the fewest possible terms; with one it is a fast, close heuristic.
+class TermPlanner {
+public:
+    // Scratch space for one planning thread, reused across plans so planning allocates nothing once warm
+    struct Workspace {
+        vector<uint32_t> mark;      // equals generation for courses in the current plan
+        vector<uint32_t> height;    // critical-path length of each planned course, in terms
+        vector<uint32_t> remaining; // prerequisites of each planned course not yet placed in a term
+        vector<uint32_t> required;  // the courses of the current plan
+        vector<uint32_t> stack;     // depth-first search stack used to collect prerequisites
+        vector<uint32_t> ready;     // heap of courses whose prerequisites are all in earlier terms
+        vector<uint32_t> targets;   // resolved target positions of the current plan
+        string field;               // trimmed, uppercase course number being looked up
+        uint32_t generation = 0;    // stamp of the current plan in mark
+    };
+
+private:
+    static constexpr uint32_t NO_RANK = UINT32_MAX; // rank of a course that is in, or depends on, a cycle
+    static const size_t STUDENT_BLOCK = 256;    // plans made by one parallel task
+
+    const Vector& catalog;            // finalized catalog the plans refer to
+    vector<uint32_t> rank;            // position of each course in the analysis' topological order
+    vector<uint8_t> hasMissing;       // 1 for courses listing a prerequisite that is not in the catalog
+
+    /*
+     * Prepare
+     *  Sizes a workspace for this catalog and starts a new plan generation
+     *
+     * @param Workspace& work - workspace to prepare
+     */
+    void Prepare(Workspace& work) const {
+        size_t courseCount = rank.size();
+        if (work.mark.size() != courseCount || ++work.generation == 0) {
+            work.mark.assign(courseCount, 0);
+            work.height.resize(courseCount);
+            work.remaining.resize(courseCount);
+            work.generation = 1;
+        }
+        work.required.clear();
+        work.ready.clear();
+    }
+
+public:
+    /*
+     * TermPlanner
+     *  Class constructor
+     *
+     * @param const Vector& finalizedCatalog - loaded catalog; must be finalized (see Vector::Finalize)
+     *                                         and must outlive the planner
+     * @param const PrerequisiteAnalysis& analysis - Analyze() result for the catalog's prerequisite graph
+     */
+    TermPlanner(const Vector& finalizedCatalog, const PrerequisiteAnalysis& analysis) : catalog(finalizedCatalog) {
+        size_t courseCount = catalog.GetCourses().size();
+        rank.assign(courseCount, NO_RANK);
+        const vector<uint32_t>& order = analysis.GetOrder();
+        for (size_t i = 0; i < order.size(); i++)
+            rank[order[i]] = static_cast<uint32_t>(i);
+
+        hasMissing.assign(courseCount, 0);
+        for (const PrerequisiteGraph::UnresolvedPrerequisite& missing : catalog.GetPrerequisiteGraph().GetUnresolved())
+            hasMissing[missing.course] = 1;
+    }
+
+    /*
+     * ResolveTargets
+     *  Looks up a comma-separated list of course numbers
+     *
+     * @param string_view list - course numbers, e.g. "CSCI300, csci350"
+     * @param Workspace& work - receives the positions in work.targets
+     * @param string& error - receives a message naming the first unknown course number
+     *
+     * @return bool - true if every course number was found
+     */
+    bool ResolveTargets(string_view list, Workspace& work, string& error) const {
+        const vector<Course>& courses = catalog.GetCourses();
+        work.targets.clear();
+        size_t start = 0;
+        while (start <= list.size()) {
+            size_t comma = list.find(',', start);
+            Utils::TrimAndUppercaseInto(list.substr(start, comma - start), work.field);
+            start = (comma == string_view::npos) ? list.size() + 1 : comma + 1;
+            if (work.field.empty())
+                continue;
+
+            const Course* course = catalog.Search(work.field);
+            if (course == nullptr) {
+                error.assign("Course ").append(work.field).append(" not found.");
+                return false;
+            }
+            work.targets.push_back(static_cast<uint32_t>(course - courses.data()));
+        }
+        return true;
+    }
+
+    /*
+     * Plan
+     *  Schedules the targets in work.targets and everything they require into terms
+     *
+     * @param size_t termCap - most courses taken in one term (at least 1)
+     * @param Workspace& work - scratch space, holding the targets from ResolveTargets
+     * @param vector<uint32_t>& scheduled - receives the course positions, term by term
+     * @param vector<uint32_t>& termStart - receives where each term starts in scheduled, plus a final end entry
+     * @param string& error - receives the reason when no plan can be made
+     *
+     * @return bool - true if a plan was made
+     */
+    bool Plan(size_t termCap, Workspace& work, vector<uint32_t>& scheduled, vector<uint32_t>& termStart, string& error) const {
+        const vector<Course>& courses = catalog.GetCourses();
+        const PrerequisiteGraph& graph = catalog.GetPrerequisiteGraph();
+        scheduled.clear();
+        termStart.assign(1, 0);
+        if (termCap == 0) {
+            error.assign("At least one course per term is needed.");
             return false;
+        }
+        Prepare(work);
+        uint32_t generation = work.generation;
+
+        // Collect the targets and everything they require
+        for (uint32_t target : work.targets) {
+            if (work.mark[target] == generation)
+                continue;
+            work.mark[target] = generation;
+            work.stack.push_back(target);
+            while (!work.stack.empty()) {
+                uint32_t course = work.stack.back();
+                work.stack.pop_back();
+                if (rank[course] == NO_RANK || hasMissing[course]) {
+                    work.stack.clear();
+                    error.assign("Course ").append(courses[course].courseNumber);
+                    error.append(rank[course] == NO_RANK ? " is part of, or depends on, a prerequisite cycle."
+                                                         : " has a prerequisite that is not in the catalog.");
+                    return false;
+                }
+                work.required.push_back(course);
+                for (uint32_t prerequisite : graph.Prerequisites(course)) {
+                    if (work.mark[prerequisite] != generation) {
+                        work.mark[prerequisite] = generation;
+                        work.stack.push_back(prerequisite);
+                    }
+                }
+            }
+        }
+
+        // Critical path: dependents come later in topological order, so walk it backward
+        sort(work.required.begin(), work.required.end(), [this](uint32_t a, uint32_t b) { return rank[a] < rank[b]; });
+        for (size_t i = work.required.size(); i-- > 0;) {
+            uint32_t course = work.required[i];
+            uint32_t height = 0;
+            for (uint32_t dependent : graph.Dependents(course)) {
+                if (work.mark[dependent] == generation)
+                    height = max(height, work.height[dependent]);
+            }
+            work.height[course] = height + 1;
+            work.remaining[course] = static_cast<uint32_t>(graph.Prerequisites(course).size());
+            if (work.remaining[course] == 0)
+                work.ready.push_back(course);
+        }
+
+        // Longest remaining chain first, then course number order
+        const vector<uint32_t>& height = work.height;
+        auto isLowerPriority = [&height](uint32_t a, uint32_t b) {
+            return (height[a] != height[b]) ? height[a] < height[b] : a > b;
+        };
+        make_heap(work.ready.begin(), work.ready.end(), isLowerPriority);
+
+        while (scheduled.size() < work.required.size()) {
+            size_t termFirst = scheduled.size();
+            while (!work.ready.empty() && scheduled.size() - termFirst < termCap) {
+                pop_heap(work.ready.begin(), work.ready.end(), isLowerPriority);
+                scheduled.push_back(work.ready.back());
+                work.ready.pop_back();
+            }
+            // Courses unlocked by this term can be taken from the next term on
+            for (size_t i = termFirst; i < scheduled.size(); i++) {
+                for (uint32_t dependent : graph.Dependents(scheduled[i])) {
+                    if (work.mark[dependent] == generation && --work.remaining[dependent] == 0) {
+                        work.ready.push_back(dependent);
+                        push_heap(work.ready.begin(), work.ready.end(), isLowerPriority);
+                    }
+                }
+            }
+            termStart.push_back(static_cast<uint32_t>(scheduled.size()));
+        }
+        return true;
+    }
+
+    /*
+     * Run
+     *  Plans every student in a file and writes one plan line per student
+     *
+     * Input lines are "STUDENT,COURSE,COURSE,..." listing each student's target courses
+     * (blank lines are skipped). Output lines are "STUDENT;COURSE,COURSE;COURSE;..."
+     * with one ';' separated group per term, or "STUDENT;ERROR: reason". Students are
+     * planned a wave at a time, one block per thread, and the blocks are written in
+     * order, so the output matches a single-threaded run.
+     *
+     * @param const char* data - first byte of the input
+     * @param size_t size - number of bytes of input
+     * @param size_t termCap - most courses taken in one term
+     * @param unsigned threadCount - number of worker threads (0 uses all cores)
+     * @param OutputBuffer& output - destination for the plans
+     *
+     * @return PlanningSummary - counts of students, failed plans and planned terms
+     */
+    PlanningSummary Run(const char* data, size_t size, size_t termCap, unsigned threadCount, OutputBuffer& output) const {
+        const vector<Course>& courses = catalog.GetCourses();
+        PlanningSummary summary;
+        unsigned threads = Utils::ResolveThreadCount(threadCount);
+        vector<Workspace> workspaces(threads);
+        vector<string> blockText(threads);
+        vector<PlanningSummary> blockSummary(threads);
+        vector<string_view> lines;
+        lines.reserve(threads * STUDENT_BLOCK);
+
+        const char* position = data;
+        const char* end = data + size;
+        while (position < end) {
+            lines.clear();
+            string_view line;
+            while (lines.size() < threads * STUDENT_BLOCK && Utils::NextLine(position, end, line))
+                lines.push_back(line);
+
+            size_t blockCount = (lines.size() + STUDENT_BLOCK - 1) / STUDENT_BLOCK;
+            Utils::RunParallel(blockCount, threads, [&](size_t block) {
+                Workspace& work = workspaces[block];
+                string& text = blockText[block];
+                vector<uint32_t> scheduled;
+                vector<uint32_t> termStart;
+                string error;
+                text.clear();
+                blockSummary[block] = PlanningSummary();
+
+                size_t last = min(lines.size(), (block + 1) * STUDENT_BLOCK);
+                for (size_t i = block * STUDENT_BLOCK; i < last; i++) {
+                    string_view line = lines[i];
+                    size_t comma = line.find(',');
+                    string_view student = line.substr(0, comma);
+                    while (!student.empty() && student.front() == ' ')
+                        student.remove_prefix(1);
+                    while (!student.empty() && student.back() == ' ')
+                        student.remove_suffix(1);
+                    string_view targets = (comma == string_view::npos) ? string_view() : line.substr(comma + 1);
+
+                    text.append(student.data(), student.size());
+                    Metrics::Timer timer(Metrics::Timing::Plan);
+                    bool isPlanned = ResolveTargets(targets, work, error) && Plan(termCap, work, scheduled, termStart, error);
+                    timer.Stop();
+                    if (!isPlanned) {
+                        text.append(";ERROR: ").append(error).push_back('\n');
+                        blockSummary[block].failed++;
+                        continue;
+                    }
+                    for (size_t term = 0; term + 1 < termStart.size(); term++) {
+                        for (uint32_t s = termStart[term]; s < termStart[term + 1]; s++) {
+                            text.push_back(s == termStart[term] ? ';' : ',');
+                            text.append(courses[scheduled[s]].courseNumber.data(), courses[scheduled[s]].courseNumber.size());
+                        }
+                    }
+                    text.push_back('\n');
+                    blockSummary[block].terms += termStart.size() - 1;
+                }
+            });
+            for (size_t block = 0; block < blockCount; block++) {
+                output.Append(blockText[block]);
+                summary.failed += blockSummary[block].failed;
+                summary.terms += blockSummary[block].terms;
+            }
+            summary.students += lines.size();
+        }
+        output.Flush();
+        return summary;
+    }
+};
+
+
+/* *****************************
+ * CatalogGenerator Class
+ ***************************** */
+
+// Settings for a generated catalog
+struct GeneratorOptions {
+    size_t courseCount = 10000;    // number of distinct courses
+    size_t departmentCount = 8;    // number of course number prefixes (CSCI, MATH, ...)
+    unsigned maxPrerequisites = 3; // each course lists 0 to this many prerequisites
+    unsigned depth = 6;            // number of prerequisite levels; prerequisites always come from a lower level
+    double duplicateRate = 0.0;    // chance that a line is followed by a second course with the same number
+    double malformedRate = 0.0;    // chance that a line is followed by a line with no course name
+    string order = "random";       // line order: random, sorted or reversed
+    uint64_t seed = 300;           // random seed, the same settings always produce the same file
+};
+
+// Writes deterministic synthetic catalogs in the input CSV format
+class CatalogGenerator {
+private:
+    /*
+     * DepartmentName
+     *  Four letter course number prefix for a department
+     *
+     * @param size_t department - department index
+     *
+     * @return string - the prefix
+     */
+    static string DepartmentName(size_t department) {
+        static const char* KNOWN[] = { "CSCI", "MATH", "PHYS", "CHEM", "BIOL", "ENGL", "HIST", "ECON" };
+        if (department < sizeof(KNOWN) / sizeof(KNOWN[0]))
+            return KNOWN[department];
+
+        string name = "AAAA";
+        for (int i = 3; i >= 0 && department > 0; i--) {
+            name[i] = static_cast<char>('A' + department % 26);
+            department /= 26;
+        }
+        return name;
+    }
+
+public:
+    /*
+     * Generate
+     *  Writes a catalog to a stream
+     *
+     * Courses are spread evenly over departments and numbered from 100. Each course
+     * gets a random level, and its prerequisites are drawn only from lower levels, so
+     * the prerequisite graph is always acyclic.
+     *
+     * @param const GeneratorOptions& options - catalog settings
+     * @param ostream& output - stream to write the CSV lines to
+     */
+    static void Generate(const GeneratorOptions& options, ostream& output) {
+        static const char* QUALIFIERS[] = { "Introduction to", "Advanced", "Applied", "Principles of", "Topics in", "Foundations of" };
+        static const char* SUBJECTS[] = { "Algorithms", "Data Structures", "Operating Systems", "Programming", "Databases",
+                                          "Computer Networks", "Calculus", "Statistics", "Mechanics", "Organic Chemistry",
+                                          "Genetics", "Literature", "World History", "Microeconomics", "Software Development" };
+        const size_t QUALIFIER_COUNT = sizeof(QUALIFIERS) / sizeof(QUALIFIERS[0]);
+        const size_t SUBJECT_COUNT = sizeof(SUBJECTS) / sizeof(SUBJECTS[0]);
+
+        mt19937_64 random(options.seed);
+        size_t courseCount = options.courseCount;
+        size_t departmentCount = max<size_t>(options.departmentCount, 1);
+        unsigned depth = max(options.depth, 1u);
+        uniform_real_distribution<double> chance(0.0, 1.0);
+
+        // Course numbers: department prefix plus a zero-padded number starting at 100
+        size_t perDepartment = (courseCount + departmentCount - 1) / departmentCount;
+        size_t digits = to_string(100 + max<size_t>(perDepartment, 1) - 1).length();
+        vector<string> numbers(courseCount);
+        for (size_t i = 0; i < courseCount; i++) {
+            string number = to_string(100 + i / departmentCount);
+            numbers[i] = DepartmentName(i % departmentCount) + string(digits - number.length(), '0') + number;
+        }
+
+        // Random levels, then courses grouped by level so lower-level courses are a prefix
+        vector<unsigned> levels(courseCount);
+        for (unsigned& level : levels)
+            level = static_cast<unsigned>(random() % depth);
+        vector<size_t> byLevel(courseCount);
+        for (size_t i = 0; i < courseCount; i++)
+            byLevel[i] = i;
+        stable_sort(byLevel.begin(), byLevel.end(), [&levels](size_t a, size_t b) { return levels[a] < levels[b]; });
+        vector<size_t> levelStart(depth + 1, 0);
+        for (unsigned level : levels)
+            levelStart[level + 1]++;
+        for (unsigned level = 0; level < depth; level++)
+            levelStart[level + 1] += levelStart[level];
+
+        vector<size_t> lineOrder(courseCount);
+        for (size_t i = 0; i < courseCount; i++)
+            lineOrder[i] = i;
+        if (options.order == "random")
+            shuffle(lineOrder.begin(), lineOrder.end(), random);
+        else
+            sort(lineOrder.begin(), lineOrder.end(), [&numbers](size_t a, size_t b) { return numbers[a] < numbers[b]; });
+        if (options.order == "reversed")
+            reverse(lineOrder.begin(), lineOrder.end());
+
+        string line;
+        for (size_t course : lineOrder) {
+            line.assign(numbers[course]).append(",");
+            line.append(QUALIFIERS[random() % QUALIFIER_COUNT]).append(" ").append(SUBJECTS[random() % SUBJECT_COUNT]);
+
+            size_t candidates = levelStart[levels[course]]; // courses on lower levels
+            unsigned prerequisiteCount = (candidates == 0) ? 0 : static_cast<unsigned>(random() % (options.maxPrerequisites + 1));
+            for (unsigned p = 0; p < prerequisiteCount; p++)
+                line.append(",").append(numbers[byLevel[random() % candidates]]);
+            line.push_back('\n');
+            output << line;
+
+            if (chance(random) < options.duplicateRate)
+                output << numbers[course] << ",Duplicate of " << numbers[course] << "\n";
+            if (chance(random) < options.malformedRate)
+                output << numbers[course] << "X,\n";
+        }
+    }
+};
+
+
+/* *****************************
+ * Benchmark Class
+ ***************************** */
+
+// Repeated, warmed-up timings of the main catalog operations, reported as JSON
+class Benchmark {
+private:
+    // Timings of one operation
+    struct Result {
+        string name;                // operation name
+        size_t operationsPerRep;    // operations performed in each timed repetition
+        vector<double> samples;     // nanoseconds per repetition
+        uint64_t allocations;       // heap allocations over all timed repetitions
+        uint64_t bytes;             // heap bytes requested over all timed repetitions
+    };
+
+    // Stream buffer that discards everything, used to time printing without a terminal
+    class NullBuffer : public streambuf {
+    protected:
+        int overflow(int character) override { return character; }
+        streamsize xsputn(const char*, streamsize count) override { return count; }
+    };
+
+    static const unsigned WARMUP_REPS = 2; // untimed repetitions before measuring
+
+    /*
+     * Measure
+     *  Times an operation over warm-up and measured repetitions
+     *
+     * @param const string& name - operation name for the report
+     * @param size_t operationsPerRep - operations done by one call of body
+     * @param unsigned reps - number of timed repetitions
+     * @param const function<void()>& setup - untimed preparation run before every repetition
+     * @param const function<void()>& body - the timed work
+     *
+     * @return Result - the collected samples and allocation counts
+     */
+    static Result Measure(const string& name, size_t operationsPerRep, unsigned reps,
+                          const function<void()>& setup, const function<void()>& body) {
+        Result result{ name, operationsPerRep, {}, 0, 0 };
+        for (unsigned i = 0; i < WARMUP_REPS; i++) {
+            setup();
+            body();
+        }
+        for (unsigned i = 0; i < reps; i++) {
+            setup();
+            uint64_t allocationsBefore = AllocationCounter::Allocations();
+            uint64_t bytesBefore = AllocationCounter::Bytes();
+            auto started = chrono::steady_clock::now();
+            body();
+            auto finished = chrono::steady_clock::now();
+            result.allocations += AllocationCounter::Allocations() - allocationsBefore;
+            result.bytes += AllocationCounter::Bytes() - bytesBefore;
+            result.samples.push_back(chrono::duration<double, nano>(finished - started).count());
+        }
+        return result;
+    }
+
+    /*
+     * WriteResult
+     *  Writes one result as a JSON object with median, p99, mean, throughput and allocation figures
+     *
+     * @param const Result& result - result to write
+     * @param ostream& output - stream to write to
+     */
+    static void WriteResult(const Result& result, ostream& output) {
+        vector<double> sorted = result.samples;
+        sort(sorted.begin(), sorted.end());
+        size_t count = max<size_t>(sorted.size(), 1);
+        double median = sorted.empty() ? 0.0 : sorted[sorted.size() / 2];
+        double p99 = sorted.empty() ? 0.0 : sorted[static_cast<size_t>(ceil(0.99 * sorted.size())) - 1];
+        double mean = 0.0;
+        for (double sample : sorted)
+            mean += sample / count;
+
+        output << "    {\"name\": \"" << result.name << "\""
+               << ", \"operations_per_rep\": " << result.operationsPerRep
+               << ", \"median_ns\": " << static_cast<uint64_t>(median)
+               << ", \"p99_ns\": " << static_cast<uint64_t>(p99)
+               << ", \"mean_ns\": " << static_cast<uint64_t>(mean)
+               << ", \"min_ns\": " << static_cast<uint64_t>(sorted.empty() ? 0.0 : sorted.front())
+               << ", \"throughput_per_s\": " << static_cast<uint64_t>(median > 0 ? result.operationsPerRep * 1e9 / median : 0)
+               << ", \"allocations_per_rep\": ";
+        // Without the counting operator new there is nothing to report, which is not the same as zero
+        if (AllocationCounter::IS_ENABLED)
+            output << result.allocations / count << ", \"bytes_allocated_per_rep\": " << result.bytes / count << "}";
+        else
+            output << "null, \"bytes_allocated_per_rep\": null}";
+    }
+
+public:
+    /*
+     * Run
+     *  Generates a catalog, times every operation and writes a JSON report
+     *
+     * @param const GeneratorOptions& options - catalog to generate
+     * @param unsigned reps - timed repetitions per operation
+     * @param unsigned threadCount - parser threads for the mapped loader (0 uses all cores)
+     * @param ostream& output - stream for the JSON report
+     */
+    static void Run(const GeneratorOptions& options, unsigned reps, unsigned threadCount, ostream& output) {
+        reps = max(reps, 1u);
+        string catalogPath = (filesystem::temp_directory_path() / ("abcu_bench_" + to_string(options.seed) + ".csv")).string();
+        {
+            ofstream catalogFile(catalogPath, ios::binary | ios::trunc);
+            CatalogGenerator::Generate(options, catalogFile);
+        }
+
+        vector<Result> results;
+        Vector catalog;
+
+        results.push_back(Measure("load_ifstream", options.courseCount, reps, [] {}, [&] {
+            ifstream file = Utils::OpenFile(catalogPath);
+            catalog.ReadCoursesFromFile(file);
+        }));
+        results.push_back(Measure("load_mapped_sorted", options.courseCount, reps, [] {}, [&] {
+            MappedFile file(catalogPath);
+            catalog.ReadCoursesFromMappedFile(file, threadCount);
+        }));
+
+        // Sort an unsorted copy of the loaded courses with each algorithm
+        vector<Course> unsorted = catalog.GetCourses();
+        shuffle(unsorted.begin(), unsorted.end(), mt19937_64(options.seed));
+        vector<Course> working;
+        SortMode originalMode = Vector::GetSortMode();
+        for (SortMode mode : { SortMode::Quicksort, SortMode::Radix }) {
+            results.push_back(Measure((mode == SortMode::Quicksort) ? "sort_quicksort" : "sort_radix", unsorted.size(), reps,
+                [&] { working = unsorted; },
+                [&] { Vector::SetSortMode(mode); Vector::SortCourses(working); }));
+        }
+        Vector::SetSortMode(originalMode);
+
+        // Lookups of existing course numbers, and of numbers that are not in the catalog
+        const size_t LOOKUPS = 100000;
+        vector<string> hits;
+        vector<string> misses;
+        mt19937_64 random(options.seed + 1);
+        const vector<Course>& courses = catalog.GetCourses();
+        for (size_t i = 0; i < LOOKUPS && !courses.empty(); i++) {
+            hits.emplace_back(courses[random() % courses.size()].courseNumber);
+            misses.push_back("ZZZZ" + to_string(random() % 1000000));
+        }
+        size_t found = 0;
+        results.push_back(Measure("search_hit", hits.size(), reps, [] {}, [&] {
+            for (const string& number : hits)
+                found += (catalog.Search(number) != nullptr);
+        }));
+        results.push_back(Measure("search_miss", misses.size(), reps, [] {}, [&] {
+            for (const string& number : misses)
+                found += (catalog.Search(number) != nullptr);
+        }));
+
+        // The same lookups as packed keys through each KeySearchIndex layout, plus keys drawn
+        // uniformly between the smallest and largest course numbers, which almost never match.
+        // Skipped when a course number is too long to pack.
+        vector<uint64_t> sortedKeys(courses.size());
+        bool allKeysPacked = !courses.empty();
+        for (size_t i = 0; i < courses.size() && allKeysPacked; i++)
+            allKeysPacked = CourseKey::Pack(courses[i].courseNumber, sortedKeys[i]);
+        if (allKeysPacked) {
+            vector<uint64_t> hitKeys(hits.size());
+            vector<uint64_t> missKeys(hits.size());
+            uniform_int_distribution<uint64_t> between(sortedKeys.front(), sortedKeys.back());
+            for (size_t i = 0; i < hits.size(); i++) {
+                CourseKey::Pack(hits[i], hitKeys[i]);
+                missKeys[i] = between(random);
+            }
+
+            KeySearchIndex keyIndex;
+            for (SearchLayout layout : { SearchLayout::Binary, SearchLayout::Eytzinger, SearchLayout::BTree }) {
+                string name = string("key_search_") + KeySearchIndex::LayoutName(layout);
+                results.push_back(Measure(name + "_build", sortedKeys.size(), reps, [] {}, [&] {
+                    keyIndex.Build(sortedKeys.data(), sortedKeys.size(), layout);
+                }));
+                results.push_back(Measure(name + "_hit", hitKeys.size(), reps, [] {}, [&] {
+                    for (uint64_t key : hitKeys)
+                        found += (keyIndex.Find(key) != SIZE_MAX);
+                }));
+                results.push_back(Measure(name + "_miss", missKeys.size(), reps, [] {}, [&] {
+                    for (uint64_t key : missKeys)
+                        found += (keyIndex.Find(key) != SIZE_MAX);
+                }));
+            }
+        }
+
+        // Lookups from every thread while a writer keeps publishing new catalog versions
+        SharedCatalog sharedCatalog;
+        sharedCatalog.Publish(Vector(catalog));
+        unsigned readerCount = Utils::ResolveThreadCount(threadCount);
+        atomic<size_t> sharedFound(0);
+        results.push_back(Measure("search_during_publish", hits.size() * readerCount, reps, [] {}, [&] {
+            atomic<bool> readersDone(false);
+            thread writer([&] {
+                while (!readersDone)
+                    sharedCatalog.Publish(Vector(catalog));
+            });
+            Utils::RunParallel(readerCount, readerCount, [&](size_t) {
+                size_t readerFound = 0;
+                for (const string& number : hits) {
+                    SharedCatalog::Snapshot snapshot = sharedCatalog.Acquire();
+                    readerFound += (snapshot->Search(number) != nullptr);
+                }
+                sharedFound += readerFound;
+            });
+            readersDone = true;
+            writer.join();
+        }));
+        found += sharedFound;
+
+        results.push_back(Measure("find_missing_prerequisites", 1, reps, [] {}, [&] {
+            found += (catalog.FindMissingPrerequisites() != nullptr);
+        }));
+        results.push_back(Measure("validate", options.courseCount, reps, [] {}, [&] {
+            MappedFile file(catalogPath);
+            found += CatalogValidator::Validate(file.Data(), file.Size(), threadCount).issues.size();
+        }));
+
+        // Print everything into a discarding stream so the terminal is not part of the timing
+        NullBuffer nullBuffer;
+        streambuf* originalBuffer = cout.rdbuf(&nullBuffer);
+        results.push_back(Measure("print_all_courses", courses.size(), reps, [] {}, [&] {
+            catalog.PrintAllCourses();
+        }));
+        cout.rdbuf(originalBuffer);
+
+        error_code error;
+        filesystem::remove(catalogPath, error);
+
+        output << "{\n";
+        output << "  \"generator\": {\"courses\": " << options.courseCount << ", \"departments\": " << options.departmentCount
+               << ", \"max_prerequisites\": " << options.maxPrerequisites << ", \"depth\": " << options.depth
+               << ", \"duplicate_rate\": " << options.duplicateRate << ", \"malformed_rate\": " << options.malformedRate
+               << ", \"order\": \"" << options.order << "\", \"seed\": " << options.seed << "},\n";
+        output << "  \"loaded_courses\": " << courses.size() << ",\n";
+        output << "  \"threads\": " << Utils::ResolveThreadCount(threadCount) << ",\n";
+        output << "  \"repetitions\": " << reps << ",\n";
+        output << "  \"checksum\": " << found << ",\n";
+        output << "  \"results\": [\n";
+        for (size_t i = 0; i < results.size(); i++) {
+            WriteResult(results[i], output);
+            output << ((i + 1 < results.size()) ? ",\n" : "\n");
+        }
+        output << "  ]\n}\n";
+    }
+};
+
+/* *****************************
+ * QueryServer Class
+ ***************************** */
+
+// Course lookups served to local clients over a Unix domain socket
+//
+// Every message, in both directions, is a 4-byte little-endian payload length followed by the payload.
+// Request payload: a command letter, then an optional course number
+//    C<course> - course and its direct prerequisites (same text as menu option 3)
+//    P<course> - course and every prerequisite it needs, directly or indirectly
+//    F<query>  - courses matching a prefix ("CSCI3") or an inclusive range ("MATH200-MATH299")
+//    N<words>  - up to NAME_RESULTS best courses whose names match a keyword query (see NameIndex::Query)
+//    L         - the whole course list
+//    R         - reload the catalog file in the background
+//    M         - every metric, in Prometheus text format (see Metrics)
+// Response payload: a status letter ('O' ok, 'N' course not found, 'E' bad request), then the text
+class QueryServer {
+public:
+    static const uint32_t MAX_REQUEST = 4096; // longest request payload accepted, in bytes
+    static const size_t NAME_RESULTS = 50;    // most name search results returned for one request
+
+    /*
+     * AppendFrame
+     *  Appends a length-prefixed message to a buffer
+     *
+     * @param char status - status letter for responses, or command letter for requests
+     * @param string_view text - rest of the payload
+     * @param string& output - buffer the message is appended to
+     */
+    static void AppendFrame(char status, string_view text, string& output) {
+        uint32_t length = static_cast<uint32_t>(text.size() + 1);
+        for (int shift = 0; shift < 32; shift += 8)
+            output.push_back(static_cast<char>((length >> shift) & 0xFF));
+        output.push_back(status);
+        output.append(text);
+    }
+
+    /*
+     * ReadLength
+     *  Decodes a 4-byte little-endian payload length
+     *
+     * @param const char* bytes - first byte of the length
+     *
+     * @return uint32_t - the payload length
+     */
+    static uint32_t ReadLength(const char* bytes) {
+        uint32_t length = 0;
+        for (int i = 3; i >= 0; i--)
+            length = (length << 8) | static_cast<unsigned char>(bytes[i]);
+        return length;
+    }
+
+#ifdef __linux__
+private:
+    // One client connection; only one worker handles it at a time (EPOLLONESHOT)
+    struct Connection {
+        int descriptor;    // connected socket
+        string input;      // received bytes not yet forming a whole request
+    };
+
+    // Per-worker scratch space, reused across requests
+    struct WorkerState {
+        string response;          // responses to the requests read in one pass
+        vector<uint32_t> marks;   // visit stamp per course position for prerequisite expansion
+        vector<uint32_t> pending; // courses found by the expansion, in visit order
+        uint32_t stamp = 0;       // current visit stamp
+    };
+
+    inline static volatile sig_atomic_t stopRequested = 0;   // set by SIGINT/SIGTERM
+    inline static volatile sig_atomic_t reloadRequested = 0; // set by SIGHUP
+
+    SharedCatalog& catalog;         // catalog versions being served
+    string listenPath;              // socket file, removed when the server closes
+    string catalogPath;             // course file re-read by reloads
+    unsigned loadThreads;           // parser threads used by reloads
+    int listenDescriptor;           // listening socket
+    int epollDescriptor;            // epoll instance watching the listener and idle connections
+    mutex queueLock;                // guards readyConnections and openConnections
+    condition_variable queueReady;  // signalled when readyConnections gains an entry or the server stops
+    deque<Connection*> readyConnections;               // connections with data waiting for a worker
+    vector<unique_ptr<Connection>> openConnections;     // every open connection, owned here
+    atomic<bool> isStopping;        // flag to tell the workers to exit
+    atomic<uint64_t> requestsServed; // number of requests answered
+
+    /*
+     * OnSignal
+     *  Signal handler: SIGHUP asks for a reload, anything else asks the server to stop
+     *
+     * @param int signalNumber - the signal received
+     */
+    static void OnSignal(int signalNumber) {
+        if (signalNumber == SIGHUP)
+            reloadRequested = 1;
+        else
+            stopRequested = 1;
+    }
+
+    /*
+     * WriteAll
+     *  Writes a whole buffer to a non-blocking socket, waiting while the socket is full
+     *
+     * @param int descriptor - socket to write to
+     * @param const string& data - bytes to write
+     *
+     * @return bool - true if everything was written; false if the client went away
+     */
+    static bool WriteAll(int descriptor, const string& data) {
+        size_t written = 0;
+        while (written < data.size()) {
+            ssize_t count = send(descriptor, data.data() + written, data.size() - written, MSG_NOSIGNAL);
+            if (count > 0) {
+                written += static_cast<size_t>(count);
+            }
+            else if (count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                pollfd waitFor{ descriptor, POLLOUT, 0 };
+                if (poll(&waitFor, 1, 5000) <= 0)
+                    return false; // client stopped reading
+            }
+            else if (!(count < 0 && errno == EINTR)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /*
+     * AppendExpansion
+     *  Appends a course and all of its direct and indirect prerequisites, nearest first
+     *
+     * @param const Vector& courses - finalized catalog version
+     * @param size_t position - position of the course in the catalog
+     * @param WorkerState& state - worker scratch space
+     * @param string& text - buffer the text is appended to
+     */
+    static void AppendExpansion(const Vector& courses, size_t position, WorkerState& state, string& text) {
+        const PrerequisiteGraph& graph = courses.GetPrerequisiteGraph();
+        const vector<Course>& collection = courses.GetCourses();
+        if (state.marks.size() != graph.CourseCount())
+            state.marks.assign(graph.CourseCount(), 0);
+        if (++state.stamp == 0) {
+            fill(state.marks.begin(), state.marks.end(), 0);
+            state.stamp = 1;
+        }
+
+        // Breadth-first walk of the prerequisite edges
+        state.pending.clear();
+        state.pending.push_back(static_cast<uint32_t>(position));
+        state.marks[position] = state.stamp;
+        for (size_t i = 0; i < state.pending.size(); i++) {
+            for (uint32_t prerequisite : graph.Prerequisites(state.pending[i])) {
+                if (state.marks[prerequisite] != state.stamp) {
+                    state.marks[prerequisite] = state.stamp;
+                    state.pending.push_back(prerequisite);
+                }
+            }
+        }
+
+        const Course& course = collection[position];
+        text.append(course.courseNumber).append(", ").append(course.name);
+        text.append("\nAll prerequisites (").append(to_string(state.pending.size() - 1)).append("):");
+        for (size_t i = 1; i < state.pending.size(); i++) {
+            const Course& prerequisite = collection[state.pending[i]];
+            text.append("\n   ").append(prerequisite.courseNumber).append(", ").append(prerequisite.name);
+        }
+    }
+
+    /*
+     * HandleRequest
+     *  Answers one request payload, appending the response message
+     *
+     * @param string_view request - request payload
+     * @param WorkerState& state - worker scratch space; the response is appended to state.response
+     */
+    void HandleRequest(string_view request, WorkerState& state) {
+        requestsServed++;
+        if (request.empty()) {
+            AppendFrame('E', "Empty request", state.response);
+            return;
+        }
+
+        // Hold one catalog version for the whole request
+        SharedCatalog::Snapshot courses = catalog.Acquire();
+        char command = request[0];
+        string courseNumber;
+        Utils::TrimAndUppercaseInto(request.substr(1), courseNumber);
+
+        string& output = state.response;
+        size_t frameStart = output.size();
+        output.append(5, '\0'); // length and status, filled in below
+        char status = 'O';
+        uint64_t started = Metrics::Now();
+        if (command == 'C' || command == 'P') {
+            const Course* course = courses->Search(courseNumber);
+            if (course == nullptr) {
+                status = 'N';
+                output.append("Course ").append(courseNumber).append(" not found.");
+            }
+            else if (command == 'C') {
+                courses->FormatCourse(course, true, output);
+            }
+            else {
+                AppendExpansion(*courses, static_cast<size_t>(course - courses->GetCourses().data()), state, output);
+            }
+        }
+        else if (command == 'F') {
+            pair<size_t, size_t> span = courses->FindSpan(courseNumber);
+            const vector<Course>& collection = courses->GetCourses();
+            for (size_t i = span.first; i < span.second; i++) {
+                courses->FormatCourse(&collection[i], false, output);
+                output.push_back('\n');
+            }
+        }
+        else if (command == 'N') {
+            vector<uint32_t> ranked;
+            size_t total = courses->SearchNames(request.substr(1), NAME_RESULTS, ranked);
+            output.append(to_string(total)).append(" match(es)");
+            for (uint32_t position : ranked) {
+                output.push_back('\n');
+                courses->FormatCourse(&courses->GetCourses()[position], false, output);
+            }
+        }
+        else if (command == 'L') {
+            for (const Course& course : courses->GetCourses()) {
+                courses->FormatCourse(&course, false, output);
+                output.push_back('\n');
+            }
+        }
+        else if (command == 'R') {
+            if (catalog.StartReload(catalogPath, loadThreads))
+                output.append("Reload started.");
+            else
+                output.append("Reload already running.");
+        }
+        else if (command == 'M') {
+            ostringstream metrics;
+            Metrics::WritePrometheus(metrics);
+            output.append(metrics.str());
+        }
+        else {
+            status = 'E';
+            output.append("Unknown command");
+        }
+
+        if (command == 'C' || command == 'P')
+            Metrics::Record(Metrics::Timing::Search, Metrics::Now() - started);
+        else if (command == 'F')
+            Metrics::Record(Metrics::Timing::Range, Metrics::Now() - started);
+        else if (command == 'N')
+            Metrics::Record(Metrics::Timing::NameSearch, Metrics::Now() - started);
+        else if (command == 'L')
+            Metrics::Record(Metrics::Timing::Print, Metrics::Now() - started);
+
+        // Patch the length and status in front of the text
+        uint32_t length = static_cast<uint32_t>(output.size() - frameStart - 4);
+        for (int i = 0; i < 4; i++)
+            output[frameStart + i] = static_cast<char>((length >> (8 * i)) & 0xFF);
+        output[frameStart + 4] = status;
+    }
+
+    /*
+     * CloseConnection
+     *  Closes a client connection and releases its state
+     *
+     * @param Connection* connection - connection to close
+     */
+    void CloseConnection(Connection* connection) {
+        close(connection->descriptor); // also removes it from the epoll set
+        lock_guard<mutex> guard(queueLock);
+        for (size_t i = 0; i < openConnections.size(); i++) {
+            if (openConnections[i].get() == connection) {
+                openConnections[i].swap(openConnections.back());
+                openConnections.pop_back();
+                break;
+            }
+        }
+    }
+
+    /*
+     * ServeConnection
+     *  Reads what a client sent, answers every complete request, then waits for more
+     *
+     * @param Connection* connection - connection with data waiting
+     * @param WorkerState& state - worker scratch space
+     */
+    void ServeConnection(Connection* connection, WorkerState& state) {
+        bool isClosed = false;
+        char block[1 << 16];
+        while (true) {
+            ssize_t count = read(connection->descriptor, block, sizeof(block));
+            if (count > 0) {
+                connection->input.append(block, static_cast<size_t>(count));
+                continue;
+            }
+            if (count < 0 && errno == EINTR)
+                continue;
+            isClosed = (count == 0 || (errno != EAGAIN && errno != EWOULDBLOCK));
+            break;
+        }
+
+        // Answer every whole request, keeping a partial one for the next read
+        state.response.clear();
+        size_t offset = 0;
+        const string& input = connection->input;
+        while (input.size() - offset >= 4) {
+            uint32_t length = ReadLength(input.data() + offset);
+            if (length > MAX_REQUEST) {
+                isClosed = true;
+                break;
+            }
+            if (input.size() - offset - 4 < length)
+                break;
+            HandleRequest(string_view(input.data() + offset + 4, length), state);
+            offset += 4 + length;
+        }
+        connection->input.erase(0, offset);
+
+        if (!state.response.empty() && !WriteAll(connection->descriptor, state.response))
+            isClosed = true;
+        if (state.response.capacity() > (16u << 20))
+            string().swap(state.response); // do not keep a huge list response per worker
+
+        if (isClosed) {
+            CloseConnection(connection);
+            return;
+        }
+        epoll_event event{};
+        event.events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+        event.data.ptr = connection;
+        if (epoll_ctl(epollDescriptor, EPOLL_CTL_MOD, connection->descriptor, &event) != 0)
+            CloseConnection(connection);
+    }
+
+    /*
+     * WorkerLoop
+     *  Body of each worker thread: takes ready connections off the queue and serves them
+     */
+    void WorkerLoop() {
+        WorkerState state;
+        while (true) {
+            Connection* connection;
+            {
+                unique_lock<mutex> guard(queueLock);
+                queueReady.wait(guard, [this] { return isStopping || !readyConnections.empty(); });
+                if (isStopping)
+                    return;
+                connection = readyConnections.front();
+                readyConnections.pop_front();
+            }
+            ServeConnection(connection, state);
+        }
+    }
+
+    /*
+     * AcceptConnections
+     *  Accepts every pending client and adds it to the epoll set
+     */
+    void AcceptConnections() {
+        while (true) {
+            int descriptor = accept4(listenDescriptor, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (descriptor < 0) {
+                if (errno == EINTR)
+                    continue;
+                return; // EAGAIN: no more pending clients
+            }
+
+            unique_ptr<Connection> connection(new Connection{ descriptor, string() });
+            epoll_event event{};
+            event.events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+            event.data.ptr = connection.get();
+            if (epoll_ctl(epollDescriptor, EPOLL_CTL_ADD, descriptor, &event) != 0) {
+                close(descriptor);
+                continue;
+            }
+            lock_guard<mutex> guard(queueLock);
+            openConnections.push_back(move(connection));
+        }
+    }
+
+public:
+    /*
+     * QueryServer
+     *  Class constructor
+     * Creates the listening socket. A stale socket file at the same path is replaced;
+     * any other kind of file there is left alone and reported as an error.
+     *
+     * @param SharedCatalog& sharedCatalog - catalog versions to serve
+     * @param const string& socketPath - file system path of the Unix domain socket
+     * @param const string& reloadPath - course file re-read by reload requests
+     * @param unsigned threadCount - parser threads used by reloads (0 uses all cores)
+     */
+    QueryServer(SharedCatalog& sharedCatalog, const string& socketPath, const string& reloadPath, unsigned threadCount)
+        : catalog(sharedCatalog), listenPath(socketPath), catalogPath(reloadPath), loadThreads(threadCount),
+          listenDescriptor(-1), epollDescriptor(-1), isStopping(false), requestsServed(0) {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        if (socketPath.empty() || socketPath.size() >= sizeof(address.sun_path))
+            throw runtime_error("ERROR: Socket path is empty or too long");
+        memcpy(address.sun_path, socketPath.c_str(), socketPath.size() + 1);
+
+        struct stat existing;
+        if (lstat(socketPath.c_str(), &existing) == 0) {
+            if (!S_ISSOCK(existing.st_mode))
+                throw runtime_error("ERROR: Socket path exists and is not a socket");
+            unlink(socketPath.c_str());
+        }
+
+        listenDescriptor = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (listenDescriptor < 0)
+            throw runtime_error("ERROR: Could not open socket");
+        if (bind(listenDescriptor, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0
+            || listen(listenDescriptor, SOMAXCONN) != 0) {
+            close(listenDescriptor);
+            throw runtime_error("ERROR: Could not listen on socket");
+        }
+
+        epollDescriptor = epoll_create1(EPOLL_CLOEXEC);
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.ptr = nullptr; // the listener is the only entry without a Connection
+        if (epollDescriptor < 0 || epoll_ctl(epollDescriptor, EPOLL_CTL_ADD, listenDescriptor, &event) != 0) {
+            close(listenDescriptor);
+            if (epollDescriptor >= 0)
+                close(epollDescriptor);
+            throw runtime_error("ERROR: Could not create epoll instance");
+        }
+    }
+
+    QueryServer(const QueryServer&) = delete;
+    QueryServer& operator=(const QueryServer&) = delete;
 
-        courseCollection.push_back(*course);
-        isSorted = false;
-        return true;
+    /*
+     * ~QueryServer
+     *  Class destructor
+     * Closes every connection and the listening socket, and removes the socket file.
+     */
+    ~QueryServer() {
+        for (unique_ptr<Connection>& connection : openConnections)
+            close(connection->descriptor);
+        close(epollDescriptor);
+        close(listenDescriptor);
+        unlink(listenPath.c_str());
     }
 
     /*
-     * PrintCourse
-     *  Prints a single course's information
+     * Run
+     *  Serves clients until SIGINT or SIGTERM; SIGHUP reloads the catalog file
      *
-     * Outputs the course number and name, and optionally its prerequisites.
+     * The calling thread waits on epoll, accepts clients and queues connections that
+     * have data; a fixed pool of workers reads, answers and re-arms them.
      *
-     * @param Course* course - pointer to the Course to print
-     * @param bool includePrerequisites - whether to include prerequisite information
+     * @param unsigned workerCount - number of worker threads (0 uses all cores)
+     *
+     * @return uint64_t - number of requests answered
      */
-    void PrintCourse(Course* course, bool includePrerequisites = false) {
-        if (!IsValidCourseObject(course))
-            return;
+    uint64_t Run(unsigned workerCount) {
+        stopRequested = 0;
+        reloadRequested = 0;
+        signal(SIGINT, OnSignal);
+        signal(SIGTERM, OnSignal);
+        signal(SIGHUP, OnSignal);
 
-        // Print line has been adjusted from Pseudocode to match example provided for this assignment:
-        //   Example Lines: 
-        // CSCI400, Large Software Development
-        // Prerequisites: CSCI301, CSCI350
-        // HOWEVER the instructions specify: "You will then print the name of the course and the prerequisite course numbers and titles."
-        // So line 2 has been updated to:
-        // Prerequisites: CSCI301, Advanced Programming in C++; CSCI350, Operating Systems
-        string courseInfo = course->courseNumber + ", " + course->name;
-        string prerequisiteLineHeader = "\nPrerequisites: ";
-        string prerequisiteInfo = "None";
+        vector<thread> workers;
+        for (unsigned i = 0; i < Utils::ResolveThreadCount(workerCount); i++)
+            workers.emplace_back([this] { WorkerLoop(); });
 
-        // Only print Prerequisites if they exist and the 'includePrerequisites' print flag is true
-        if (!course->prerequisites.empty() and includePrerequisites) {
-            prerequisiteInfo = "";
-            for (const string& prereq : course->prerequisites) {
-                Course* tempCourse = Search(prereq);
-                if (tempCourse != nullptr) {                    
-                    prerequisiteInfo += tempCourse->courseNumber + ", " + tempCourse->name + "; ";
+        epoll_event events[64];
+        while (!stopRequested) {
+            if (reloadRequested) {
+                reloadRequested = 0;
+                catalog.StartReload(catalogPath, loadThreads);
+            }
+
+            int count = epoll_wait(epollDescriptor, events, 64, 200); // wake up regularly to check the signal flags
+            if (count > 0) {
+                lock_guard<mutex> guard(queueLock);
+                for (int i = 0; i < count; i++) {
+                    if (events[i].data.ptr != nullptr)
+                        readyConnections.push_back(static_cast<Connection*>(events[i].data.ptr));
                 }
             }
-            if (!prerequisiteInfo.empty())
-                prerequisiteInfo = prerequisiteInfo.substr(0, prerequisiteInfo.length() - 2);
-            else
-                prerequisiteInfo = "Error: Prerequisites expected, but none found";
-        }
-        else if (!includePrerequisites) { // Not printing prerequisits
-            prerequisiteInfo = "";
-            prerequisiteLineHeader = "";
+            for (int i = 0; i < count; i++) {
+                if (events[i].data.ptr == nullptr)
+                    AcceptConnections();
+            }
+            if (count > 0)
+                queueReady.notify_all();
         }
 
-        // Print on 1 or 2 lines. prerequisiteLineHeader + prerequisiteInfo will be blank if not printing prerequisits
-        cout << courseInfo + prerequisiteLineHeader + prerequisiteInfo << endl;
+        {
+            lock_guard<mutex> guard(queueLock);
+            isStopping = true;
+        }
+        queueReady.notify_all();
+        for (thread& worker : workers)
+            worker.join();
+        catalog.WaitForReload();
+        signal(SIGINT, SIG_DFL);
+        signal(SIGTERM, SIG_DFL);
+        signal(SIGHUP, SIG_DFL);
+        return requestsServed;
     }
+#endif
+};
+
+
+/* *****************************
+ * LoadGenerator Class
+ ***************************** */
 
+// Client that drives a QueryServer from many connections and reports throughput and latency
+class LoadGenerator {
+#ifdef __linux__
+private:
     /*
-     * PrintAllCourses
-     *  Prints all stored courses in sorted order
+     * Connect
+     *  Opens a blocking connection to the server
      *
-     * Sorts the collection if needed and prints each course without
-     * prerequisite details.
+     * @param const string& socketPath - path of the server socket
+     *
+     * @return int - connected socket
      */
-    void PrintAllCourses() {
-        if (!isSorted) {
-            SortVector(courseCollection);
-            isSorted = true;
+    static int Connect(const string& socketPath) {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        if (socketPath.empty() || socketPath.size() >= sizeof(address.sun_path))
+            throw runtime_error("ERROR: Socket path is empty or too long");
+        memcpy(address.sun_path, socketPath.c_str(), socketPath.size() + 1);
+
+        int descriptor = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (descriptor < 0 || connect(descriptor, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+            if (descriptor >= 0)
+                close(descriptor);
+            throw runtime_error("ERROR: Could not connect to " + socketPath);
         }
+        return descriptor;
+    }
 
-        for (Course& course : courseCollection) {
-            PrintCourse(&course); // print course, but without prerequisits
+    /*
+     * Exchange
+     *  Sends one request and waits for its response
+     *
+     * @param int descriptor - connected socket
+     * @param const string& request - whole request message, length prefix included
+     * @param string& response - receives the response payload (status letter first)
+     *
+     * @return bool - true if a whole response arrived
+     */
+    static bool Exchange(int descriptor, const string& request, string& response) {
+        size_t written = 0;
+        while (written < request.size()) {
+            ssize_t count = send(descriptor, request.data() + written, request.size() - written, MSG_NOSIGNAL);
+            if (count <= 0 && errno != EINTR)
+                return false;
+            written += static_cast<size_t>(max<ssize_t>(count, 0));
         }
+
+        char header[4];
+        if (!ReadExactly(descriptor, header, 4))
+            return false;
+        response.resize(QueryServer::ReadLength(header));
+        return ReadExactly(descriptor, &response[0], response.size());
     }
 
     /*
-     * ReadCoursesFromFile
-     *  Loads courses from an open input file
+     * ReadExactly
+     *  Reads a fixed number of bytes from a blocking socket
      *
-     * Reads the file line-by-line, converts each line into a Course object,
-     * and inserts it into the collection.
+     * @param int descriptor - connected socket
+     * @param char* buffer - destination
+     * @param size_t size - number of bytes to read
      *
-     * @param ifstream& file - reference to an open file stream containing course data
+     * @return bool - true if all bytes arrived before the connection closed
      */
-    void ReadCoursesFromFile(ifstream& file) {
-        if (!file.is_open())
-            return;
+    static bool ReadExactly(int descriptor, char* buffer, size_t size) {
+        size_t received = 0;
+        while (received < size) {
+            ssize_t count = recv(descriptor, buffer + received, size - received, 0);
+            if (count == 0 || (count < 0 && errno != EINTR))
+                return false;
+            received += static_cast<size_t>(max<ssize_t>(count, 0));
+        }
+        return true;
+    }
+#endif
 
-        // Clear structure before loading to prevent loading the same data twice
-        courseCollection.clear();
+public:
+    /*
+     * Run
+     *  Fetches the course list, then sends random lookups from many connections at once
+     *
+     * Each client sends one request at a time and times it from send to full response.
+     * The mix is 80% course lookups, 10% prerequisite expansions and 10% lookups of
+     * course numbers that do not exist.
+     *
+     * @param const string& socketPath - path of the server socket
+     * @param unsigned clientCount - number of concurrent connections
+     * @param size_t requestsPerClient - requests sent by each connection
+     * @param uint64_t seed - random seed for the request mix
+     * @param ostream& output - stream for the JSON report
+     */
+    static void Run(const string& socketPath, unsigned clientCount, size_t requestsPerClient, uint64_t seed, ostream& output) {
+#ifdef __linux__
+        clientCount = max(clientCount, 1u);
 
-        string line;
-        while (getline(file, line)) {
-            Course* course = ParseLineToCourse(line);
-            if (course == nullptr) {
-                cout << "Error parsing file line: " << line << endl;
-                return;
+        // Course numbers to ask for come from the server's own list
+        vector<string> courseNumbers;
+        {
+            int descriptor = Connect(socketPath);
+            string request;
+            string response;
+            QueryServer::AppendFrame('L', "", request);
+            bool received = Exchange(descriptor, request, response);
+            close(descriptor);
+            if (!received)
+                throw runtime_error("ERROR: No response from " + socketPath);
+            istringstream lines(response.substr(1));
+            string line;
+            while (getline(lines, line)) {
+                size_t comma = line.find(',');
+                if (comma != string::npos)
+                    courseNumbers.push_back(line.substr(0, comma));
             }
-            Insert(course);
-            delete course; // avoid memory leak
         }
+        if (courseNumbers.empty())
+            throw runtime_error("ERROR: Server catalog is empty");
+
+        vector<vector<uint32_t>> latencies(clientCount); // microseconds, per client
+        atomic<size_t> found(0);
+        atomic<size_t> failures(0);
+        auto started = chrono::steady_clock::now();
+        vector<thread> clients;
+        for (unsigned client = 0; client < clientCount; client++) {
+            clients.emplace_back([&, client] {
+                mt19937_64 random(seed + client);
+                vector<uint32_t>& samples = latencies[client];
+                samples.reserve(requestsPerClient);
+                string request;
+                string response;
+                size_t clientFound = 0;
+                int descriptor = -1;
+                try {
+                    descriptor = Connect(socketPath);
+                }
+                catch (const exception&) {
+                    failures += requestsPerClient;
+                    return;
+                }
+                for (size_t i = 0; i < requestsPerClient; i++) {
+                    unsigned kind = static_cast<unsigned>(random() % 10);
+                    request.clear();
+                    if (kind == 0)
+                        QueryServer::AppendFrame('C', "ZZZZ" + to_string(random() % 1000000), request);
+                    else
+                        QueryServer::AppendFrame((kind == 1) ? 'P' : 'C', courseNumbers[random() % courseNumbers.size()], request);
+
+                    auto sent = chrono::steady_clock::now();
+                    if (!Exchange(descriptor, request, response)) {
+                        failures += requestsPerClient - i;
+                        break;
+                    }
+                    samples.push_back(static_cast<uint32_t>(chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - sent).count()));
+                    clientFound += (!response.empty() && response[0] == 'O');
+                }
+                found += clientFound;
+                close(descriptor);
+            });
+        }
+        for (thread& client : clients)
+            client.join();
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+
+        vector<uint32_t> all;
+        for (const vector<uint32_t>& samples : latencies)
+            all.insert(all.end(), samples.begin(), samples.end());
+        sort(all.begin(), all.end());
+        auto percentile = [&all](double fraction) -> uint32_t {
+            if (all.empty())
+                return 0;
+            return all[min(all.size() - 1, static_cast<size_t>(ceil(fraction * all.size())) - 1)];
+        };
+
+        output << "{\n";
+        output << "  \"socket\": \"" << socketPath << "\",\n";
+        output << "  \"clients\": " << clientCount << ",\n";
+        output << "  \"requests\": " << all.size() << ",\n";
+        output << "  \"failed_requests\": " << failures << ",\n";
+        output << "  \"found\": " << found << ",\n";
+        output << "  \"seconds\": " << seconds << ",\n";
+        output << "  \"throughput_per_s\": " << static_cast<uint64_t>(seconds > 0 ? all.size() / seconds : 0) << ",\n";
+        output << "  \"latency_us\": {\"p50\": " << percentile(0.50) << ", \"p90\": " << percentile(0.90)
+               << ", \"p99\": " << percentile(0.99) << ", \"p999\": " << percentile(0.999)
+               << ", \"max\": " << (all.empty() ? 0 : all.back()) << "}\n";
+        output << "}\n";
+#else
+        (void)socketPath; (void)clientCount; (void)requestsPerClient; (void)seed; (void)output;
+        throw runtime_error("ERROR: The load generator needs Linux (Unix domain sockets and epoll)");
+#endif
     }
 };
 
@@ -463,38 +7473,409 @@ public:
  * loading, searching, and printing operations.
  *
  * @param int argc - argument count (always at least 1 by default, 2 or more if a user includes any)
- * @param char* argv[] - command-line arguments (optional file path)
+ * @param char* argv[] - command-line arguments (optional file path, and options)
+ *    --threads N - number of parser threads used when loading (default 1, 0 uses all cores)
+ *    --storage vector|compact - keep the loaded courses as Course objects (default) or as a packed CompactCatalog
+ *    --sort radix|quicksort - sort with the key-permutation radix sort (default) or the recursive Quicksort
+ *    --search-layout btree|eytzinger|binary - order of the compact catalog's search index (default btree)
+ *    --snapshot - serve the catalog from a binary snapshot next to the CSV (FILE.snapshot) when it is
+ *                 fresh; otherwise load the CSV, write a new snapshot, and use compact storage
+ *    --generate FILE - write a synthetic catalog CSV to FILE and exit
+ *    --bench - generate a catalog, time load, sort, search and print, and write a JSON report
+ *        generator settings for both: --courses N, --departments N, --fanout N, --depth N,
+ *        --duplicates RATE, --malformed RATE, --order random|sorted|reversed, --seed N
+ *        benchmark settings: --reps N (default 10), --bench-output FILE (default standard output);
+ *        allocation figures are reported only when built with COUNT_ALLOCATIONS defined
+ *    --batch FILE - load the catalog, look up every course number in FILE ("-" reads standard input)
+ *                   and write the results to standard output, without showing the menu
+ *    --eligibility FILE - load the catalog, read student transcripts ("STUDENT,COURSE,...") from FILE
+ *                         ("-" reads standard input) and write each student's eligible courses to standard output
+ *    --plan FILE - load the catalog, read target courses ("STUDENT,COURSE,...") from FILE ("-" reads
+ *                  standard input) and write a term-by-term plan for each student to standard output.
+ *                  --term-cap N sets the most courses per term (default 4)
+ *    --catalog-dir DIR - load every .csv file in DIR as one department shard (CSCI, MATH, ...) instead of a
+ *                        single file; menu options 2, 3, 4 and 6 work across departments, and 6 reloads
+ *                        only the department files that changed
+ *    --metrics FILE - write latency histograms, counters and gauges to FILE when the program exits
+ *    --metrics-format json|prometheus - format of --metrics and of menu option 11 (default json)
+ *    --validate - check the whole file for malformed lines, duplicate IDs, missing prerequisites,
+ *                 self-references and cycles, write a JSON report to standard output and exit
+ *                 (exit status 0 if the file is clean, 2 if problems were found)
+ *    --serve SOCKET - load the catalog once and answer queries on a Unix domain socket until
+ *                     interrupted (Linux); SIGHUP reloads the file. --workers N sets the pool size (default all cores)
+ *    --load-test SOCKET - drive a running server and write a JSON throughput and latency report
+ *        load settings: --clients N (default 8), --requests N per client (default 10000), --seed N
  *
  * @return int - program exit status
  */
 int main(int argc, char* argv[]) {
-    string csvPath;
+    string csvPath = FILE_PATH;
+    unsigned loadThreads = 1;
+    bool useCompactStorage = false;
+    bool useSnapshot = false;
+    string batchPath;
+    string eligibilityPath;
+    string planPath;
+    size_t termCap = 4;
+    string metricsPath;
+    bool isPrometheusFormat = false;
+    string catalogDirectory;        // when set, the menu loads one file per department from this directory
+    ShardedCatalog shardedCatalog; // department shards loaded from catalogDirectory
+    string generatePath;
+    bool runBenchmark = false;
+    bool runValidation = false;
+    GeneratorOptions generatorOptions;
+    unsigned benchmarkReps = 10;
+    string benchmarkOutputPath;
+    string servePath;
+    string loadTestPath;
+    unsigned workerCount = 0;
+    unsigned clientCount = 8;
+    size_t requestsPerClient = 10000;
     Vector dataStructure;
+    CompactCatalog compactCatalog; // holds the courses instead of dataStructure when compact storage is in use
+    PrerequisiteAnalysis analysis; // order, levels and cycles of dataStructure's prerequisites
+    bool isAnalysisCurrent = false; // flag to show if analysis matches the loaded courses
     int choice = 0;
 
-    if (argc > 1)  // If any command line arguments are supplied, assume its the file path/name
-        csvPath = argv[1];
-    else
-        csvPath = FILE_PATH;
+    // Options start with "--"; any other command line argument is assumed to be the file path/name
+    for (int i = 1; i < argc; i++) {
+        string argument = argv[i];
+        if (argument == "--threads" && i + 1 < argc) {
+            try {
+                loadThreads = static_cast<unsigned>(stoul(argv[++i]));
+            }
+            catch (const exception&) {
+                cout << "Invalid thread count, loading with 1 thread." << endl;
+                loadThreads = 1;
+            }
+        }
+        else if (argument == "--sort" && i + 1 < argc) {
+            Vector::SetSortMode((string(argv[++i]) == "quicksort") ? SortMode::Quicksort : SortMode::Radix);
+        }
+        else if (argument == "--search-layout" && i + 1 < argc) {
+            string layout = argv[++i];
+            if (layout == "btree")
+                CompactCatalog::SetSearchLayout(SearchLayout::BTree);
+            else if (layout == "eytzinger")
+                CompactCatalog::SetSearchLayout(SearchLayout::Eytzinger);
+            else if (layout == "binary")
+                CompactCatalog::SetSearchLayout(SearchLayout::Binary);
+            else {
+                cerr << "Invalid value for " << argument << endl;
+                return 1;
+            }
+        }
+        else if (argument == "--generate" && i + 1 < argc) {
+            generatePath = argv[++i];
+        }
+        else if (argument == "--bench") {
+            runBenchmark = true;
+        }
+        else if (argument == "--validate") {
+            runValidation = true;
+        }
+        else if (argument == "--bench-output" && i + 1 < argc) {
+            benchmarkOutputPath = argv[++i];
+        }
+        else if (argument == "--order" && i + 1 < argc) {
+            generatorOptions.order = argv[++i];
+        }
+        else if ((argument == "--courses" || argument == "--departments" || argument == "--fanout" || argument == "--depth"
+                  || argument == "--seed" || argument == "--reps" || argument == "--duplicates" || argument == "--malformed")
+                 && i + 1 < argc) {
+            try {
+                string value = argv[++i];
+                if (argument == "--courses")
+                    generatorOptions.courseCount = stoull(value);
+                else if (argument == "--departments")
+                    generatorOptions.departmentCount = stoull(value);
+                else if (argument == "--fanout")
+                    generatorOptions.maxPrerequisites = static_cast<unsigned>(stoul(value));
+                else if (argument == "--depth")
+                    generatorOptions.depth = static_cast<unsigned>(stoul(value));
+                else if (argument == "--seed")
+                    generatorOptions.seed = stoull(value);
+                else if (argument == "--reps")
+                    benchmarkReps = static_cast<unsigned>(stoul(value));
+                else if (argument == "--duplicates")
+                    generatorOptions.duplicateRate = stod(value);
+                else
+                    generatorOptions.malformedRate = stod(value);
+            }
+            catch (const exception&) {
+                cerr << "Invalid value for " << argument << endl;
+                return 1;
+            }
+        }
+        else if (argument == "--serve" && i + 1 < argc) {
+            servePath = argv[++i];
+        }
+        else if (argument == "--load-test" && i + 1 < argc) {
+            loadTestPath = argv[++i];
+        }
+        else if ((argument == "--workers" || argument == "--clients" || argument == "--requests") && i + 1 < argc) {
+            try {
+                string value = argv[++i];
+                if (argument == "--workers")
+                    workerCount = static_cast<unsigned>(stoul(value));
+                else if (argument == "--clients")
+                    clientCount = static_cast<unsigned>(stoul(value));
+                else
+                    requestsPerClient = stoull(value);
+            }
+            catch (const exception&) {
+                cerr << "Invalid value for " << argument << endl;
+                return 1;
+            }
+        }
+        else if (argument == "--batch" && i + 1 < argc) {
+            batchPath = argv[++i];
+        }
+        else if (argument == "--eligibility" && i + 1 < argc) {
+            eligibilityPath = argv[++i];
+        }
+        else if (argument == "--plan" && i + 1 < argc) {
+            planPath = argv[++i];
+        }
+        else if (argument == "--catalog-dir" && i + 1 < argc) {
+            catalogDirectory = argv[++i];
+        }
+        else if (argument == "--metrics" && i + 1 < argc) {
+            metricsPath = argv[++i];
+        }
+        else if (argument == "--metrics-format" && i + 1 < argc) {
+            isPrometheusFormat = (string(argv[++i]) == "prometheus");
+        }
+        else if (argument == "--term-cap" && i + 1 < argc) {
+            try {
+                termCap = stoull(argv[++i]);
+            }
+            catch (const exception&) {
+                cerr << "Invalid value for " << argument << endl;
+                return 1;
+            }
+        }
+        else if (argument == "--snapshot") {
+            useSnapshot = true;
+        }
+        else if (argument == "--storage" && i + 1 < argc) {
+            useCompactStorage = (string(argv[++i]) == "compact");
+        }
+        else {
+            csvPath = argument;
+        }
+    }
+
+    if (!metricsPath.empty())
+        Metrics::ExportAtExit(metricsPath, isPrometheusFormat);
+
+    // Generator and benchmark modes: no menu
+    if (!generatePath.empty()) {
+        ofstream catalogFile(generatePath, ios::binary | ios::trunc);
+        if (!catalogFile.is_open()) {
+            cerr << "ERROR: Could not open file" << endl;
+            return 1;
+        }
+        CatalogGenerator::Generate(generatorOptions, catalogFile);
+        return 0;
+    }
+    if (runBenchmark) {
+        if (benchmarkOutputPath.empty()) {
+            Benchmark::Run(generatorOptions, benchmarkReps, loadThreads, cout);
+        }
+        else {
+            ofstream report(benchmarkOutputPath, ios::trunc);
+            Benchmark::Run(generatorOptions, benchmarkReps, loadThreads, report);
+        }
+        return 0;
+    }
+
+    // Validation mode: no menu, the report goes to standard output
+    if (runValidation) {
+        try {
+            MappedFile file = Utils::MapFile(csvPath);
+            CatalogValidator::Report report = CatalogValidator::Validate(file.Data(), file.Size(), loadThreads);
+            CatalogValidator::WriteJson(report, csvPath, cout);
+            return report.IsValid() ? 0 : 2;
+        }
+        catch (const exception& e) {
+            cerr << e.what() << endl;
+            return 1;
+        }
+    }
+
+    // Server and load generator modes: no menu, progress goes to standard error
+    if (!servePath.empty()) {
+#ifdef __linux__
+        try {
+            SharedCatalog sharedCatalog;
+            sharedCatalog.Load(csvPath, loadThreads);
+            QueryServer server(sharedCatalog, servePath, csvPath, loadThreads);
+            cerr << "Serving " << sharedCatalog.Acquire()->GetCourses().size() << " course(s) on " << servePath
+                 << " with " << Utils::ResolveThreadCount(workerCount) << " worker(s)." << endl;
+            uint64_t served = server.Run(workerCount);
+            cerr << "Server stopped after " << served << " request(s)." << endl;
+        }
+        catch (const exception& e) {
+            cerr << e.what() << endl;
+            return 1;
+        }
+        return 0;
+#else
+        cerr << "Server mode needs Linux (Unix domain sockets and epoll)." << endl;
+        return 1;
+#endif
+    }
+    if (!loadTestPath.empty()) {
+        try {
+            LoadGenerator::Run(loadTestPath, clientCount, requestsPerClient, generatorOptions.seed, cout);
+        }
+        catch (const exception& e) {
+            cerr << e.what() << endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    // Batch mode: no menu, results go to standard output and progress to standard error
+    if (!batchPath.empty()) {
+        try {
+            auto started = chrono::steady_clock::now();
+            MappedFile file = Utils::MapFile(csvPath);
+            dataStructure.ReadCoursesFromMappedFile(file, loadThreads);
+
+            string standardInput;
+            unique_ptr<MappedFile> queryFile;
+            if (batchPath == "-") {
+                standardInput = Utils::ReadAllStdin();
+            }
+            else {
+                queryFile.reset(new MappedFile(batchPath));
+            }
+            const char* queryData = queryFile ? queryFile->Data() : standardInput.data();
+            size_t querySize = queryFile ? queryFile->Size() : standardInput.size();
+
+            OutputBuffer output(stdout);
+            size_t found = BatchQuery::Run(dataStructure, queryData, querySize, loadThreads, output);
+            chrono::duration<double> elapsed = chrono::steady_clock::now() - started;
+            cerr << "Batch complete: " << found << " course(s) found in " << elapsed.count() << " seconds" << endl;
+        }
+        catch (const exception& e) {
+            cerr << e.what() << endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    // Eligibility mode: no menu, results go to standard output and progress to standard error
+    if (!eligibilityPath.empty()) {
+        try {
+            auto started = chrono::steady_clock::now();
+            MappedFile file = Utils::MapFile(csvPath);
+            dataStructure.ReadCoursesFromMappedFile(file, loadThreads);
+            dataStructure.Finalize();
+            EligibilityEngine engine(dataStructure);
+
+            string standardInput;
+            unique_ptr<MappedFile> transcriptFile;
+            if (eligibilityPath == "-") {
+                standardInput = Utils::ReadAllStdin();
+            }
+            else {
+                transcriptFile.reset(new MappedFile(eligibilityPath));
+            }
+            const char* transcriptData = transcriptFile ? transcriptFile->Data() : standardInput.data();
+            size_t transcriptSize = transcriptFile ? transcriptFile->Size() : standardInput.size();
+
+            OutputBuffer output(stdout);
+            EligibilitySummary summary = engine.Run(transcriptData, transcriptSize, loadThreads, output);
+            chrono::duration<double> elapsed = chrono::steady_clock::now() - started;
+            cerr << "Eligibility complete: " << summary.students << " student(s), " << summary.eligible
+                 << " eligible course(s) in " << elapsed.count() << " seconds" << endl;
+            if (summary.unknown > 0)
+                cerr << summary.unknown << " completed course number(s) were not in the catalog." << endl;
+        }
+        catch (const exception& e) {
+            cerr << e.what() << endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    // Planning mode: no menu, plans go to standard output and progress to standard error
+    if (!planPath.empty()) {
+        try {
+            MappedFile file = Utils::MapFile(csvPath);
+            dataStructure.ReadCoursesFromMappedFile(file, loadThreads);
+            dataStructure.Finalize();
+            analysis.Analyze(dataStructure.GetPrerequisiteGraph());
+            TermPlanner planner(dataStructure, analysis);
+
+            string standardInput;
+            unique_ptr<MappedFile> targetFile;
+            if (planPath == "-") {
+                standardInput = Utils::ReadAllStdin();
+            }
+            else {
+                targetFile.reset(new MappedFile(planPath));
+            }
+            const char* targetData = targetFile ? targetFile->Data() : standardInput.data();
+            size_t targetSize = targetFile ? targetFile->Size() : standardInput.size();
+
+            OutputBuffer output(stdout);
+            auto started = chrono::steady_clock::now();
+            PlanningSummary summary = planner.Run(targetData, targetSize, termCap, loadThreads, output);
+            chrono::duration<double> elapsed = chrono::steady_clock::now() - started;
+            cerr << "Planning complete: " << summary.students << " plan(s), " << summary.failed << " failed, "
+                 << summary.terms << " term(s) in " << elapsed.count() << " seconds ("
+                 << elapsed.count() * 1000.0 / max<size_t>(summary.students, 1) << " seconds per 1000 plans)" << endl;
+        }
+        catch (const exception& e) {
+            cerr << e.what() << endl;
+            return 1;
+        }
+        return 0;
+    }
 
     // Request file/path name from user
-    cout << "Enter a filename (and optional path) to read course data from," << endl;
-    cout << "or press [Enter] to use the default: " + csvPath << endl;
+    if (catalogDirectory.empty()) {
+        cout << "Enter a filename (and optional path) to read course data from," << endl;
+        cout << "or press [Enter] to use the default: " + csvPath << endl;
+    }
+    else {
+        cout << "Enter a directory of department course files to read course data from," << endl;
+        cout << "or press [Enter] to use the default: " + catalogDirectory << endl;
+    }
     string fileName;
     getline(cin, fileName);  // get file name/path from user, gets whole line
 
     // If the user entered a filename, use that
-    if (!fileName.empty())
-        csvPath = fileName;
+    if (!fileName.empty()) {
+        if (catalogDirectory.empty())
+            csvPath = fileName;
+        else
+            catalogDirectory = fileName;
+    }
 
     cout << endl << endl << "Welcome to the course planner." << endl;
 
     while (choice != 9) {
         cout << endl; // blank line before printing menu
         cout << "Menu:" << endl;
-        cout << "  1. Load Data Structure. File [" << csvPath << "]" << endl;
+        if (catalogDirectory.empty())
+            cout << "  1. Load Data Structure. File [" << csvPath << "]" << endl;
+        else
+            cout << "  1. Load Data Structure. Directory [" << catalogDirectory << "]" << endl;
         cout << "  2. Print Course List." << endl;
         cout << "  3. Print Course." << endl;
+        cout << "  4. Print All Prerequisites For Course." << endl;
+        cout << "  5. Print Course Order." << endl;
+        cout << "  6. Reload Changed Course Data." << endl;
+        cout << "  7. Find Courses By Prefix Or Range." << endl;
+        cout << "  8. Search Course Names." << endl;
+        cout << " 10. Plan Term Schedule." << endl;
+        cout << " 11. Show Metrics." << endl;
         cout << "  9. Exit" << endl;
         cout << "What would you like to do? ";
 
@@ -506,39 +7887,154 @@ int main(int argc, char* argv[]) {
             choice = 0;  // set choice to its default value / known safe invalid choice
         }
 
+        // A department-sharded catalog has its own load, list, search, prerequisite and reload handling
+        if (!catalogDirectory.empty() && choice >= 1 && choice <= 10 && choice != 9) {
+            if (choice == 1) { // Load every department file
+                uint64_t started = Metrics::Now();
+                try {
+                    shardedCatalog.LoadFiles(ShardedCatalog::ListCatalogFiles(catalogDirectory), loadThreads);
+                    cout << "Courses loaded: " << shardedCatalog.Size() << " course(s) in departments";
+                    for (const string& department : shardedCatalog.Departments())
+                        cout << " " << department;
+                    cout << "." << endl;
+                    size_t missing = shardedCatalog.CountMissingPrerequisites();
+                    if (missing > 0)
+                        cout << missing << " prerequisite(s) are not in any department." << endl;
+                }
+                catch (const exception& e) {
+                    cout << e.what() << endl;
+                    cout << "NO Courses loaded." << endl;
+                }
+                cout << "   Time: " << (Metrics::Now() - started) / 1e9 << " seconds" << endl;
+            }
+            else if (shardedCatalog.IsEmpty()) {
+                cout << "No course data exists, please load course data first." << endl;
+            }
+            else if (choice == 2) { // Print course list
+                cout << "Here is the course list:" << endl << endl;
+                Metrics::Timer timer(Metrics::Timing::Print);
+                shardedCatalog.PrintAllCourses();
+                cout << "   Time: " << timer.Stop() << " seconds" << endl;
+            }
+            else if (choice == 3 || choice == 4) { // Search, with direct or all prerequisites
+                cout << "Enter course number to search: ";
+                string searchCourseNumber;
+                getline(cin >> ws, searchCourseNumber);
+                searchCourseNumber = Utils::TrimAndUppercase(searchCourseNumber);
+
+                Metrics::Timer timer(choice == 3 ? Metrics::Timing::Search : Metrics::Timing::Analysis);
+                const Course* course = shardedCatalog.Search(searchCourseNumber);
+                string courseInfo;
+                if (course == nullptr) {
+                    courseInfo.append("Course ").append(searchCourseNumber).append(" not found.");
+                }
+                else if (choice == 3) {
+                    shardedCatalog.FormatCourse(course, true, courseInfo);
+                }
+                else {
+                    vector<string_view> missing;
+                    vector<const Course*> required = shardedCatalog.AllPrerequisites(course, missing);
+                    shardedCatalog.FormatCourse(course, false, courseInfo);
+                    courseInfo.append("\nAll prerequisites (").append(to_string(required.size())).append("):");
+                    for (const Course* prerequisite : required)
+                        courseInfo.append("\n   ").append(prerequisite->courseNumber).append(", ").append(prerequisite->name);
+                    for (string_view number : missing)
+                        courseInfo.append("\n   ").append(number).append(", (not found in catalog)");
+                }
+                double seconds = timer.Stop();
+                cout << courseInfo << endl;
+                cout << "   Time: " << seconds << " seconds" << endl;
+            }
+            else if (choice == 6) { // Reload the department files that changed
+                uint64_t started = Metrics::Now();
+                vector<string> messages;
+                size_t replaced = shardedCatalog.ReloadChanged(loadThreads, messages);
+                for (const string& message : messages)
+                    cout << message << endl;
+                cout << replaced << " department(s) reloaded." << endl;
+                cout << "   Time: " << (Metrics::Now() - started) / 1e9 << " seconds" << endl;
+            }
+            else if (choice == 5 || choice == 7 || choice == 8 || choice == 10) {
+                cout << "This option needs a single course file (run without --catalog-dir)." << endl;
+            }
+            else { // Invalid option selected
+                cout << choice << " is not a valid option." << endl;
+            }
+            continue;
+        }
+
         if (choice == 1) { // Load courses from file
-            clock_t ticks = clock();
-            // use Try..Catch to open file
-            ifstream file;
+            uint64_t started = Metrics::Now(); // the load itself is recorded by the loaders
+            // use Try..Catch to map file
             try {
-                file = Utils::OpenFile(csvPath);
-                dataStructure.ReadCoursesFromFile(file);
-                cout << "Courses loaded." << endl;
+                compactCatalog.Clear();
+                isAnalysisCurrent = false;
+
+                // A fresh snapshot replaces parsing entirely
+                string snapshotPath = csvPath + ".snapshot";
+                uint64_t sourceSize = 0;
+                int64_t sourceModified = 0;
+                bool hasSourceStamp = useSnapshot && Utils::GetFileStamp(csvPath, sourceSize, sourceModified);
+                if (hasSourceStamp && compactCatalog.LoadSnapshot(snapshotPath, sourceSize, sourceModified)) {
+                    dataStructure = Vector();
+                    cout << "Courses loaded from snapshot " << snapshotPath << "." << endl;
+                }
+                else {
+                    MappedFile file = Utils::MapFile(csvPath);
+                    dataStructure.ReadCoursesFromMappedFile(file, loadThreads);
+                    cout << "Courses loaded using " << Utils::ResolveThreadCount(loadThreads) << " thread(s)." << endl;
+                    CatalogValidator::PrintSummary(CatalogValidator::Validate(file.Data(), file.Size(), loadThreads), 10);
+
+                    // Repack into compact storage and release the Course objects
+                    if (useCompactStorage || useSnapshot) {
+                        size_t vectorBytes = dataStructure.MemoryFootprint();
+                        size_t residentBefore = Utils::ResidentSetBytes();
+                        if (compactCatalog.Build(dataStructure.GetCourses())) {
+                            dataStructure = Vector();
+                            size_t courseCount = max<size_t>(compactCatalog.Size(), 1);
+                            cout << "Compact storage: " << compactCatalog.MemoryFootprint() / courseCount << " bytes/course (vector storage: "
+                                 << vectorBytes / courseCount << " bytes/course)" << endl;
+                            cout << "   Resident memory: " << residentBefore / 1024 << " KB before, "
+                                 << Utils::ResidentSetBytes() / 1024 << " KB after" << endl;
+
+                            if (hasSourceStamp) {
+                                if (compactCatalog.WriteSnapshot(snapshotPath, sourceSize, sourceModified))
+                                    cout << "Snapshot written to " << snapshotPath << "." << endl;
+                                else
+                                    cout << "Could not write snapshot " << snapshotPath << "." << endl;
+                            }
+                        }
+                        else {
+                            cout << "Course numbers longer than " << CourseKey::MAX_LENGTH << " characters, keeping vector storage." << endl;
+                        }
+                    }
+                }
             }
             catch (const exception& e) {
                 cout << e.what() << endl;
                 cout << "NO Courses loaded." << endl;
             }            
-            ticks = clock() - ticks;
-            cout << "   Time: " << ticks << " clock ticks" << endl;
-            cout << "   Time: " << (double)ticks / CLOCKS_PER_SEC << " seconds" << endl;
+            double seconds = (Metrics::Now() - started) / 1e9;
+            cout << "   Time: " << seconds << " seconds" << endl;
         }
         else if (choice == 2) { // Print course list
             // Warn user if no courses have been loaded
-            if (dataStructure.IsEmpty()) {
+            if (dataStructure.IsEmpty() && compactCatalog.IsEmpty()) {
                 cout << "No course data exists, please load course data first." << endl;
                 continue;
             }
-            cout << "Here is a sample schedule:" << endl << endl;
-            clock_t ticks = clock();
-            dataStructure.PrintAllCourses();
-            ticks = clock() - ticks;
-            cout << "   Time: " << ticks << " clock ticks" << endl;
-            cout << "   Time: " << (double)ticks / CLOCKS_PER_SEC << " seconds" << endl;
+            cout << "Here is the course list:" << endl << endl;
+            Metrics::Timer timer(Metrics::Timing::Print);
+            if (!compactCatalog.IsEmpty())
+                compactCatalog.PrintAllCourses();
+            else
+                dataStructure.PrintAllCourses();
+            double seconds = timer.Stop();
+            cout << "   Time: " << seconds << " seconds" << endl;
         }
         else if (choice == 3) { // Search for course
             // Warn user if no courses have been loaded
-            if (dataStructure.IsEmpty()) {
+            if (dataStructure.IsEmpty() && compactCatalog.IsEmpty()) {
                 cout << "No course data exists, please load course data first." << endl;
                 continue;
             }
@@ -549,15 +8045,255 @@ int main(int argc, char* argv[]) {
             // for entered course string, remove whitespace and covert to uppercase so matches stored course numbers
             searchCourseNumber = Utils::TrimAndUppercase(searchCourseNumber);
 
-            clock_t ticks = clock();
+            if (!compactCatalog.IsEmpty()) {
+                Metrics::Timer timer(Metrics::Timing::Search);
+                size_t position = compactCatalog.Search(searchCourseNumber);
+                double seconds = timer.Stop();
+                if (position != SIZE_MAX)
+                    compactCatalog.PrintCourse(position, true); //print course, and include prerequisites
+                else
+                    cout << "Course " << searchCourseNumber << " not found." << endl;
+                cout << "   Time: " << seconds << " seconds" << endl;
+                continue;
+            }
+
+            Metrics::Timer timer(Metrics::Timing::Search);
             Course* course = dataStructure.Search(searchCourseNumber);
-            ticks = clock() - ticks;
+            double seconds = timer.Stop();
             if (Vector::IsValidCourseObject(course))
                 dataStructure.PrintCourse(course, true); //print course, and include prerequisites
             else
                 cout << "Course " << searchCourseNumber << " not found." << endl;
-            cout << "   Time: " << ticks << " clock ticks" << endl;
-            cout << "   Time: " << (double)ticks / CLOCKS_PER_SEC << " seconds" << endl;
+            cout << "   Time: " << seconds << " seconds" << endl;
+        }
+        else if (choice == 4 || choice == 5) { // Prerequisite analysis
+            // Warn user if no courses have been loaded
+            if (dataStructure.IsEmpty()) {
+                if (compactCatalog.IsEmpty())
+                    cout << "No course data exists, please load course data first." << endl;
+                else
+                    cout << "This option needs vector storage (run without --storage compact or --snapshot)." << endl;
+                continue;
+            }
+
+            string searchCourseNumber;
+            if (choice == 4) {
+                cout << "Enter course number to search: ";
+                getline(cin >> ws, searchCourseNumber);
+                searchCourseNumber = Utils::TrimAndUppercase(searchCourseNumber);
+            }
+
+            Metrics::Timer timer(Metrics::Timing::Analysis);
+            const PrerequisiteGraph& graph = dataStructure.GetPrerequisiteGraph();
+            const vector<Course>& courses = dataStructure.GetCourses();
+            if (!isAnalysisCurrent) {
+                analysis.Analyze(graph);
+                isAnalysisCurrent = true;
+            }
+
+            // Report cycles first, since those courses cannot be ordered
+            for (const vector<uint32_t>& cycle : analysis.GetCycles()) {
+                cout << "Prerequisite cycle found: ";
+                for (uint32_t course : cycle)
+                    cout << courses[course].courseNumber << " -> ";
+                cout << courses[cycle.front()].courseNumber << endl;
+            }
+
+            if (choice == 4) {
+                Course* course = dataStructure.Search(searchCourseNumber);
+                if (!Vector::IsValidCourseObject(course)) {
+                    cout << "Course " << searchCourseNumber << " not found." << endl;
+                }
+                else {
+                    // One course needs only the part of the graph it reaches
+                    size_t position = static_cast<size_t>(course - courses.data());
+                    vector<uint32_t> required = analysis.AllPrerequisites(graph, position);
+
+                    // List in taking order: lowest level first
+                    stable_sort(required.begin(), required.end(), [&analysis](uint32_t a, uint32_t b) {
+                        return analysis.GetLevel(a) < analysis.GetLevel(b);
+                    });
+                    cout << course->courseNumber << ", " << course->name << endl;
+                    if (analysis.GetLevel(position) < 0)
+                        cout << "Error: course is part of, or depends on, a prerequisite cycle" << endl;
+                    cout << "All prerequisites (" << required.size() << "):" << endl;
+                    for (uint32_t prerequisite : required)
+                        cout << "   " << courses[prerequisite].courseNumber << ", " << courses[prerequisite].name << endl;
+                }
+            }
+            else {
+                // Kahn's order is valid but interleaves levels, so group it by level for display
+                vector<uint32_t> byLevel = analysis.GetOrder();
+                stable_sort(byLevel.begin(), byLevel.end(), [&analysis](uint32_t a, uint32_t b) {
+                    return analysis.GetLevel(a) < analysis.GetLevel(b);
+                });
+                long currentLevel = -1;
+                for (uint32_t course : byLevel) {
+                    if (analysis.GetLevel(course) != currentLevel) {
+                        currentLevel = analysis.GetLevel(course);
+                        cout << "Level " << currentLevel << ":" << endl;
+                    }
+                    cout << "   " << courses[course].courseNumber << ", " << courses[course].name << endl;
+                }
+                if (!analysis.IsAcyclic())
+                    cout << courses.size() - analysis.GetOrder().size() << " course(s) could not be ordered because of prerequisite cycles." << endl;
+            }
+            double seconds = timer.Stop();
+            cout << "   Time: " << seconds << " seconds" << endl;
+        }
+        else if (choice == 6) { // Apply only the changes in the course file
+            if (dataStructure.IsEmpty()) {
+                if (compactCatalog.IsEmpty())
+                    cout << "No course data exists, please load course data first." << endl;
+                else
+                    cout << "This option needs vector storage (run without --storage compact or --snapshot)." << endl;
+                continue;
+            }
+
+            try {
+                MappedFile file = Utils::MapFile(csvPath);
+                ReloadSummary summary = dataStructure.ReloadCoursesFromMappedFile(file, loadThreads);
+                if (!summary.applied) {
+                    cout << "Reload abandoned, the current courses were kept." << endl;
+                    continue;
+                }
+                if (summary.inserted + summary.updated + summary.deleted > 0)
+                    isAnalysisCurrent = false;
+                cout << "Courses reloaded: " << summary.inserted << " inserted, " << summary.updated << " updated, "
+                     << summary.deleted << " deleted, " << summary.unchanged << " unchanged." << endl;
+                cout << "   Time: " << summary.seconds << " seconds" << endl;
+            }
+            catch (const exception& e) {
+                cout << e.what() << endl;
+                cout << "Reload abandoned, the current courses were kept." << endl;
+            }
+        }
+        else if (choice == 7) { // Prefix, range and autocomplete queries
+            if (dataStructure.IsEmpty()) {
+                if (compactCatalog.IsEmpty())
+                    cout << "No course data exists, please load course data first." << endl;
+                else
+                    cout << "This option needs vector storage (run without --storage compact or --snapshot)." << endl;
+                continue;
+            }
+            cout << "Enter a course number prefix (e.g. CSCI3) or range (e.g. MATH200-MATH299): ";
+            string query;
+            getline(cin >> ws, query);
+            query = Utils::TrimAndUppercase(query);
+
+            Metrics::Timer timer(Metrics::Timing::Range);
+            dataStructure.Finalize(); // prefix and range searches need the sorted collection
+            pair<size_t, size_t> span;
+            if (query.find('-') == string::npos) {
+                string completion;
+                span = dataStructure.Autocomplete(query, completion);
+                if (completion.size() > query.size())
+                    cout << "Completes to: " << completion << endl;
+            }
+            else {
+                span = dataStructure.FindSpan(query);
+            }
+
+            // Stream the matching slice in bulk rather than line by line
+            {
+                OutputBuffer output(stdout);
+                const vector<Course>& courses = dataStructure.GetCourses();
+                for (size_t i = span.first; i < span.second; i++) {
+                    dataStructure.FormatCourse(&courses[i], false, output.Text());
+                    output.Text().push_back('\n');
+                    output.FlushIfFull();
+                }
+            }
+            double seconds = timer.Stop();
+            cout << span.second - span.first << " course(s) found." << endl;
+            cout << "   Time: " << seconds << " seconds" << endl;
+        }
+        else if (choice == 8) { // Keyword search of course names
+            if (dataStructure.IsEmpty()) {
+                if (compactCatalog.IsEmpty())
+                    cout << "No course data exists, please load course data first." << endl;
+                else
+                    cout << "This option needs vector storage (run without --storage compact or --snapshot)." << endl;
+                continue;
+            }
+            cout << "Enter words to search for (OR between alternatives, * after a prefix): ";
+            string query;
+            getline(cin >> ws, query);
+
+            Metrics::Timer timer(Metrics::Timing::NameSearch);
+            dataStructure.Finalize(); // the name index is built with the sorted collection
+            vector<uint32_t> ranked;
+            size_t total = dataStructure.SearchNames(query, 25, ranked);
+            double seconds = timer.Stop();
+            const vector<Course>& courses = dataStructure.GetCourses();
+            for (uint32_t position : ranked) {
+                string courseInfo;
+                dataStructure.FormatCourse(&courses[position], false, courseInfo);
+                cout << courseInfo << endl;
+            }
+            cout << total << " course(s) found";
+            if (total > ranked.size())
+                cout << ", showing the best " << ranked.size();
+            cout << "." << endl;
+            cout << "   Time: " << seconds << " seconds" << endl;
+        }
+        else if (choice == 10) { // Term-by-term plan for a set of target courses
+            if (dataStructure.IsEmpty()) {
+                if (compactCatalog.IsEmpty())
+                    cout << "No course data exists, please load course data first." << endl;
+                else
+                    cout << "This option needs vector storage (run without --storage compact or --snapshot)." << endl;
+                continue;
+            }
+            cout << "Enter target course numbers, separated by commas: ";
+            string targets;
+            getline(cin >> ws, targets);
+            cout << "Most courses per term [" << termCap << "]: ";
+            string capText;
+            getline(cin, capText);
+            size_t cap = termCap;
+            try {
+                if (capText.find_first_not_of(' ') != string::npos)
+                    cap = stoull(capText);
+            }
+            catch (const exception&) {
+                cout << "Invalid course count, using " << termCap << "." << endl;
+            }
+
+            Metrics::Timer timer(Metrics::Timing::Plan);
+            dataStructure.Finalize(); // plans use the sorted collection's graph
+            if (!isAnalysisCurrent) {
+                analysis.Analyze(dataStructure.GetPrerequisiteGraph());
+                isAnalysisCurrent = true;
+            }
+            TermPlanner planner(dataStructure, analysis);
+            TermPlanner::Workspace work;
+            vector<uint32_t> scheduled;
+            vector<uint32_t> termStart;
+            string error;
+            bool isPlanned = planner.ResolveTargets(targets, work, error) && planner.Plan(cap, work, scheduled, termStart, error);
+            double seconds = timer.Stop();
+
+            if (!isPlanned) {
+                cout << error << endl;
+            }
+            else {
+                const vector<Course>& courses = dataStructure.GetCourses();
+                cout << "Here is a sample schedule:" << endl;
+                for (size_t term = 0; term + 1 < termStart.size(); term++) {
+                    cout << "Term " << term + 1 << ":" << endl;
+                    for (uint32_t s = termStart[term]; s < termStart[term + 1]; s++)
+                        cout << "   " << courses[scheduled[s]].courseNumber << ", " << courses[scheduled[s]].name << endl;
+                }
+                cout << scheduled.size() << " course(s) in " << termStart.size() - 1 << " term(s)." << endl;
+            }
+            cout << "   Time: " << seconds << " seconds" << endl;
+        }
+        else if (choice == 11) { // Latency, counter and gauge report
+            if (isPrometheusFormat)
+                Metrics::WritePrometheus(cout);
+            else
+                Metrics::WriteJson(cout);
         }
         else if (choice == 9) {
             cout << "Thank you for using the course planner!" << endl;